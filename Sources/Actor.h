@@ -2,6 +2,7 @@
 #include <entt/entt.hpp>
 
 struct SDL_Renderer;
+struct RenderSnapshot;
 
 enum class EInputEvent
 {
@@ -17,6 +18,15 @@ public:
 	virtual void on_construct(SDL_Renderer* renderer, entt::registry* registry) {};
 	virtual void on_update(float delta_time) {};
 	virtual void on_fixed_update() {};
-	virtual void on_render(SDL_Renderer* renderer) {};
+	// Blend is how far the frame is between the last two fixed steps, [0, 1]
+	virtual void on_render(SDL_Renderer* renderer, float blend) {};
+
+	// With a render thread, on_snapshot copies what to draw at the end of the update,
+	// on_render_snapshot draws it later on the render thread, which also runs on_construct
+	virtual void on_snapshot(RenderSnapshot& snapshot, float blend) {};
+	virtual void on_render_snapshot(SDL_Renderer* renderer, const RenderSnapshot& snapshot) {};
 	virtual void on_input(EInputEvent evt, bool changed) {};
+
+	// Nothing moves without input, the engine may sleep until an event when every actor is idle
+	virtual bool is_idle() const { return false; };
 };
@@ -1,199 +1,497 @@
 #include "Arcanoid.h"
 
 #include "Engine.h"
+#include "Profiler.h"
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
 #include <random>
 
-static inline const SDL_Rect make_sdl_rect(const Rect& rect)
+// Hot component combinations are owning groups, their arrays stay packed and are walked linearly.
+// Every owned component can belong to one group only, Transform and Sprite go to rendering.
+static auto get_sprite_group(entt::registry* registry)
 {
-	return { (int)(rect.position.x - rect.dimensions.x / 2.0f),
-			 (int)(rect.position.y - rect.dimensions.y / 2.0f),
-			 (int)rect.dimensions.x,
-			 (int)rect.dimensions.y };
+	return registry->group<Transform, Sprite>();
 }
 
-static inline const SDL_Rect make_sdl_rect(const Circle& rect)
+static auto get_movable_group(entt::registry* registry)
 {
-	return { (int)(rect.position.x - rect.radius),
-			 (int)(rect.position.y - rect.radius),
-			 (int)rect.radius * 2,
-			 (int)rect.radius * 2 };
+	return registry->group<Movable>(entt::get<Transform>, entt::exclude<Ball>);
 }
 
-void Resources::construct(SDL_Renderer* renderer, entt::registry* registry)
+static auto get_block_group(entt::registry* registry)
 {
+	return registry->group<Life>(entt::get<Block, Transform>);
+}
+
+// Pools are created on first access, which would race when systems run concurrently
+template<class ... types>
+static void prepare_pools(entt::registry* registry)
+{
+	(registry->view<types>(), ...);
+}
+
+// State outside the registry, declared to the system graph like components
+struct PlayerStateAccess {};
+struct SchedulerAccess {};
+struct BlockGridAccess {};
+struct RandomAccess {};
+
+// Transform and Movable are shared by everything that moves, but every system moves entities of its own kind.
+// Those writes are declared per kind, so systems moving different things can overlap. Blocks never move.
+struct BallMotion {};
+struct PlatformMotion {};
+struct PickupMotion {};
+struct AttachedMotion {};
+
+// Sprite ids: block colors, crack colors, ball, platform, laser, pickup
+static constexpr uint16_t c_sprite_count = EBLOCKCOLOR_NUMBER + ECRACKCOLOR_NUMBER + 4;
+
+const TextureRegion& Resources::get_sprite(uint16_t id) const
+{
+	if (id < EBLOCKCOLOR_NUMBER)
+	{
+		return tex_block[id];
+	}
+	id -= EBLOCKCOLOR_NUMBER;
+
+	if (id < ECRACKCOLOR_NUMBER)
+	{
+		return tex_crack[id];
+	}
+	id -= ECRACKCOLOR_NUMBER;
+
+	switch (id)
+	{
+	case 0:  return tex_ball;
+	case 1:  return tex_platform;
+	case 2:  return tex_laser;
+	default: return tex_pickup;
+	}
+}
+
+uint16_t Resources::get_sprite_id(const TextureRegion& region) const
+{
+	// Every sprite is in the atlas, so the uv tells them apart
+	for (uint16_t id = 0; id < c_sprite_count; ++id)
+	{
+		const TextureRegion& sprite = get_sprite(id);
+		if (sprite.texture == region.texture
+			&& sprite.uv.min.x == region.uv.min.x && sprite.uv.min.y == region.uv.min.y
+			&& sprite.uv.max.x == region.uv.max.x && sprite.uv.max.y == region.uv.max.y)
+		{
+			return id;
+		}
+	}
+	return 0;
+}
+
+void Resources::construct(SDL_Renderer* renderer, entt::registry* registry, ThreadPool& thread_pool)
+{
+	// Headless simulation doesn't need any assets
+	if (renderer == nullptr)
+	{
+		return;
+	}
+
 	// Load resources
 	char* base_path_cstr = SDL_GetBasePath();
 	const std::string base_path{ base_path_cstr };
 	SDL_free(base_path_cstr);
 
+	// Names are relative to Resources/, which is also how larcanoid_pack names them
+	const std::string resources_path{ base_path + "Resources/" };
+
+	// Packed archive holds decoded pixels and samples, loose files are decoded in parallel
+	const bool packed = archive.open((base_path + "Resources.pak").c_str());
+
 	constexpr std::string_view block_paths[EBLOCKCOLOR_NUMBER]{
-	"Resources/images/soft_block_cyan.png",
-	"Resources/images/soft_block_green.png",
-	"Resources/images/soft_block_purple.png",
-	"Resources/images/soft_block_red.png",
-	"Resources/images/soft_block_yellow.png",
+	"images/soft_block_cyan.png",
+	"images/soft_block_green.png",
+	"images/soft_block_purple.png",
+	"images/soft_block_red.png",
+	"images/soft_block_yellow.png",
 	};
 
 	constexpr std::string_view crack_paths[ECRACKCOLOR_NUMBER]{
-		"Resources/images/hard_block_cr1.png",
-		"Resources/images/hard_block_cr2.png"
+		"images/hard_block_cr1.png",
+		"images/hard_block_cr2.png"
+	};
+
+	// Images are decoded to surfaces on the pool, the atlas needs all of them before the first frame
+	TaskCounter images_pending{ 0 };
+	const auto load_image = [&](std::string_view relative_path, SDL_Surface*& surface)
+	{
+		if (packed)
+		{
+			surface = archive.create_surface(relative_path);
+			return;
+		}
+
+		thread_pool.submit([path = resources_path + relative_path.data(), &surface]()
+		{
+			surface = IMG_Load(path.c_str());
+		}, images_pending);
 	};
 
+	SDL_Surface* block_surfaces[EBLOCKCOLOR_NUMBER]{};
 	for (size_t i = 0; i < EBLOCKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + block_paths[i].data() };
-		tex_block[i] = IMG_LoadTexture(renderer, path.c_str());
+		load_image(block_paths[i], block_surfaces[i]);
 	}
 
+	SDL_Surface* crack_surfaces[ECRACKCOLOR_NUMBER]{};
 	for (size_t i = 0; i < ECRACKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + crack_paths[i].data() };
-		tex_crack[i] = IMG_LoadTexture(renderer, path.c_str());
+		load_image(crack_paths[i], crack_surfaces[i]);
+	}
+
+	SDL_Surface* ball_surface{ nullptr };
+	SDL_Surface* platform_surface{ nullptr };
+	SDL_Surface* laser_surface{ nullptr };
+	SDL_Surface* pickup_surface{ nullptr };
+	load_image("images/ball.png",     ball_surface);
+	load_image("images/platform.png", platform_surface);
+	load_image("images/laser.png",    laser_surface);
+	load_image("images/pickup.png",   pickup_surface);
+
+	// Font is small and TTF isn't thread safe, so it is opened while the images decode
+	constexpr std::string_view font_path{ "fonts/Roboto-Regular.ttf" };
+	if (packed)
+	{
+		ttf_font = TTF_OpenFontRW(archive.open_blob(font_path), 1, 12);
+	}
+	else
+	{
+		ttf_font = TTF_OpenFont((resources_path + font_path.data()).c_str(), 12);
 	}
 
-	ttf_font = TTF_OpenFont("Resources/fonts/Roboto-Regular.ttf", 12);
+	thread_pool.wait(images_pending);
 
+	// Added in a fixed order, so the atlas layout doesn't depend on which decode finished first
+	size_t block_images[EBLOCKCOLOR_NUMBER]{};
+	for (size_t i = 0; i < EBLOCKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + "Resources/images/ball.png" };
-		tex_ball = IMG_LoadTexture(renderer, path.c_str());
+		block_images[i] = atlas.add(block_surfaces[i]);
 	}
 
+	size_t crack_images[ECRACKCOLOR_NUMBER]{};
+	for (size_t i = 0; i < ECRACKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + "Resources/images/platform.png" };
-		tex_platform = IMG_LoadTexture(renderer, path.c_str());
+		crack_images[i] = atlas.add(crack_surfaces[i]);
 	}
 
+	const size_t ball_image     = atlas.add(ball_surface);
+	const size_t platform_image = atlas.add(platform_surface);
+	const size_t laser_image    = atlas.add(laser_surface);
+	const size_t pickup_image   = atlas.add(pickup_surface);
+
+	atlas.build(renderer);
+
+	for (size_t i = 0; i < EBLOCKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + "Resources/images/laser.png" };
-		tex_laser = IMG_LoadTexture(renderer, path.c_str());
+		tex_block[i] = atlas.get_region(block_images[i]);
 	}
 
+	for (size_t i = 0; i < ECRACKCOLOR_NUMBER; ++i)
 	{
-		const std::string path{ base_path + "Resources/images/pickup.png" };
-		tex_pickup = IMG_LoadTexture(renderer, path.c_str());
+		tex_crack[i] = atlas.get_region(crack_images[i]);
 	}
 
+	tex_ball     = atlas.get_region(ball_image);
+	tex_platform = atlas.get_region(platform_image);
+	tex_laser    = atlas.get_region(laser_image);
+	tex_pickup   = atlas.get_region(pickup_image);
+
 	constexpr std::string_view hitsound_paths[EHITSOUND_NUMBER]{
-		"Resources/sounds/hit_touch.wav",
-		"Resources/sounds/hit_break.wav",
-		"Resources/sounds/hit_walls.wav",
-		"Resources/sounds/hit_platf.wav",
-		"Resources/sounds/hit_bonus.wav",
-		"Resources/sounds/hit_ground.wav",
-		"Resources/sounds/hit_failure.wav",
+		"sounds/hit_touch.wav",
+		"sounds/hit_break.wav",
+		"sounds/hit_walls.wav",
+		"sounds/hit_platf.wav",
+		"sounds/hit_bonus.wav",
+		"sounds/hit_ground.wav",
+		"sounds/hit_failure.wav",
+		"sounds/laser_on.wav",
 	};
+	constexpr std::string_view music_path{ "sounds/music.wav" };
 
-	for (size_t i = 0; i < EHITSOUND_NUMBER; ++i)
+	// Packed samples are used in place, nothing to wait for
+	if (packed)
 	{
-		const std::string path{ base_path + hitsound_paths[i].data() };
-		mix_hit[i] = Mix_LoadWAV(path.c_str());
+		for (size_t i = 0; i < EHITSOUND_NUMBER; ++i)
+		{
+			mix_hit[i] = archive.create_chunk(hitsound_paths[i]);
+		}
+		music = Mix_LoadMUS_RW(archive.open_blob(music_path), 1);
+		return;
 	}
 
+	// Sounds and music keep loading while the game runs, see is_audio_ready
+	for (size_t i = 0; i < EHITSOUND_NUMBER; ++i)
 	{
-		const std::string path{ base_path + "Resources/sounds/laser_on.wav" };
-		mix_laser_on = Mix_LoadWAV(path.c_str());
+		thread_pool.submit([path = resources_path + hitsound_paths[i].data(), &chunk = mix_hit[i]]()
+		{
+			chunk = Mix_LoadWAV(path.c_str());
+		}, audio_pending);
 	}
 
+	thread_pool.submit([path = resources_path + music_path.data(), this]()
 	{
-		const std::string path{ base_path + "Resources/sounds/music.wav" };
 		music = Mix_LoadMUS(path.c_str());
-	}
+	}, audio_pending);
 }
 
-void Arcanoid::spawn_block_grid(Vector2 offset, uint32_t cols, uint32_t rows, Vector2 block_dims, Vector2 block_offset, float HP)
+bool Resources::is_audio_ready() const
 {
-	// Random generators for block color
-	static std::default_random_engine gen(SDL_GetTicks());
-	static std::uniform_int_distribution<int> index(0, EBLOCKCOLOR_NUMBER - 1);
+	return audio_pending.load(std::memory_order_acquire) == 0;
+}
+
+Resources::~Resources()
+{
+	if (music != nullptr)
+	{
+		Mix_HaltMusic();
+		Mix_FreeMusic(music);
+	}
 
-	for (uint32_t i = 0; i < rows; ++i)
+	bool has_chunks = false;
+	for (Mix_Chunk* chunk : mix_hit)
+	{
+		has_chunks = has_chunks || chunk != nullptr;
+	}
+	if (has_chunks)
 	{
-		for (uint32_t j = 0; j < cols; ++j)
+		Mix_HaltChannel(-1);
+		for (Mix_Chunk* chunk : mix_hit)
 		{
-			const Vector2 position{
-				(block_dims / 2 + offset + (block_dims + block_offset) * Vector2 { (float)i, (float)j }) + m_game_bounds.min
-			};
+			Mix_FreeChunk(chunk);
+		}
+	}
 
-			if (position.x < m_game_area.dimensions.x && position.y < m_game_area.dimensions.y)
-			{
-				entt::entity entity = m_registry->create();
-				m_registry->emplace<Rect>(entity, position, block_dims);
-				m_registry->emplace<Block>(entity);
-				m_registry->emplace<Sprite>(entity, res.tex_block[index(gen)]);
-				m_registry->emplace<Life>(entity, HP);
-				m_registry->emplace<Collider>(entity);
-			}
+	if (ttf_font != nullptr)
+	{
+		TTF_CloseFont(ttf_font);
+	}
+
+	archive.close();
+}
+
+void Arcanoid::spawn_block_grid(Vector2 offset, uint32_t columns, uint32_t rows, Vector2 block_dims, Vector2 block_offset, float HP)
+{
+	Level level;
+	level.add_grid(offset, columns, rows, block_dims, block_offset, HP, g_level_random_color);
+	spawn_level(level);
+}
+
+void Arcanoid::set_game_area(Vector2 dimensions)
+{
+	const Vector2 min{ g_game_center_s - g_game_area_s / 2 };
+	m_game_area   = { min + dimensions * g_scale / 2, dimensions * g_scale };
+	m_game_bounds = fmath::rect_to_bounds(m_game_area);
+	m_block_grid.reset(m_game_bounds, g_block_grid_cell);
+	reset_to_start(true);
+}
+
+void Arcanoid::spawn_stress_scene(uint32_t blocks, uint32_t balls)
+{
+	reset_to_start(true);
+
+	// Blocks fill the upper half in a grid of the same aspect, balls start below them
+	const Vector2  area{ m_game_area.dimensions / g_scale };
+	const Vector2  field{ area.x, area.y / 2 };
+	const uint32_t columns = fmath::max((uint32_t)ceilf(sqrtf(blocks * field.x / field.y)), 1u);
+	const uint32_t rows    = (blocks + columns - 1) / columns;
+	const Vector2  cell{ field.x / columns, field.y / fmath::max(rows, 1u) };
+
+	Level level;
+	level.add_grid(cell * 0.1f, columns, rows, cell * 0.8f, cell * 0.2f, 1, g_level_random_color);
+	level.blocks.resize(blocks);
+	spawn_level(level);
+
+	std::uniform_real_distribution<float> x(m_game_bounds.min.x + g_ball_radius, m_game_bounds.max.x - g_ball_radius);
+	std::uniform_real_distribution<float> y((m_game_bounds.min.y + m_game_bounds.max.y) / 2, m_game_bounds.max.y - g_platform_elevation * 8);
+	std::uniform_real_distribution<float> angle(-1.2f, 1.2f);
+	for (uint32_t i = 0; i < balls; ++i)
+	{
+		spawn_ball(m_registry, { x(m_random), y(m_random) }, fmath::rotated({ 0, -g_ball_start_velocity }, angle(m_random)), res.tex_ball);
+	}
+}
+
+size_t Arcanoid::spawn_level(entt::registry* registry, const Bounds& game_bounds, BlockGrid& block_grid, const Level& level, const Resources& res, Random& random)
+{
+	PROFILE_ZONE("spawn_level");
+
+	std::uniform_int_distribution<int> index(0, EBLOCKCOLOR_NUMBER - 1);
+
+	// Components are built up front, so every storage grows once and is filled by one insert
+	std::vector<Transform> transforms;
+	std::vector<Sprite>    sprites;
+	std::vector<Life>      lifes;
+	transforms.reserve(level.blocks.size());
+	sprites.reserve(level.blocks.size());
+	lifes.reserve(level.blocks.size());
+
+	for (const LevelBlock& block : level.blocks)
+	{
+		const Vector2 position{ block.position * g_scale + game_bounds.min };
+		if (position.x < game_bounds.min.x || position.x > game_bounds.max.x
+			|| position.y < game_bounds.min.y || position.y > game_bounds.max.y)
+		{
+			continue;
 		}
+
+		const uint8_t color = block.color < EBLOCKCOLOR_NUMBER ? block.color : (uint8_t)index(random);
+		transforms.push_back({ position, block.dimensions * g_scale });
+		sprites.push_back({ res.tex_block[color] });
+		lifes.push_back({ block.life });
 	}
+
+	const size_t count = transforms.size();
+	if (count < level.blocks.size())
+	{
+		SDL_Log("Skipped %zu level blocks outside of the game area", level.blocks.size() - count);
+	}
+
+	registry->reserve<Transform, Sprite, Life, Block, Collider>(registry->size<Block>() + count);
+
+	std::vector<entt::entity> entities(count);
+	registry->create(entities.begin(), entities.end());
+	registry->insert<Transform>(entities.begin(), entities.end(), transforms.begin(), transforms.end());
+	registry->insert<Sprite>(entities.begin(), entities.end(), sprites.begin(), sprites.end());
+	registry->insert<Life>(entities.begin(), entities.end(), lifes.begin(), lifes.end());
+	registry->insert<Block>(entities.begin(), entities.end());
+	registry->insert<Collider>(entities.begin(), entities.end());
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		block_grid.insert(entities[i], fmath::transform_to_rect(transforms[i]));
+	}
+	return count;
 }
 
-entt::entity Arcanoid::spawn_platform(entt::registry* registry, SDL_Texture* platform_texture)
+void Arcanoid::spawn_level(const Level& level)
 {
-	const Vector2 position{ g_game_center_s.x, g_game_area_s.y - g_platform_elevation };
+	spawn_level(m_registry, m_game_bounds, m_block_grid, level, res, m_random);
+}
+
+bool Arcanoid::load_level(std::string_view name, Level& level) const
+{
+	// larcanoid_pack stores levels compiled, headless runs never open the archive and read the text
+	if (res.archive.is_open())
+	{
+		const AssetEntry* entry = res.archive.find(name);
+		return entry != nullptr && level.load(res.archive.get_data(*entry), (size_t)entry->size);
+	}
+
+	char* base_path_cstr = SDL_GetBasePath();
+	const std::string path{ std::string{ base_path_cstr ? base_path_cstr : "" } + "Resources/" + std::string{ name } };
+	SDL_free(base_path_cstr);
+	return level.load(path.c_str());
+}
+
+// Centered, the height of the area above its top
+static Vector2 get_platform_start(const Bounds& game_bounds)
+{
+	return { (game_bounds.min.x + game_bounds.max.x) / 2, game_bounds.max.y - game_bounds.min.y - g_platform_elevation };
+}
+
+entt::entity Arcanoid::spawn_platform(entt::registry* registry, const Bounds& game_bounds, const TextureRegion& platform_texture)
+{
+	const Vector2 position{ get_platform_start(game_bounds) };
 	const Vector2 dimensions{ g_platform_dimensions };
 
 	entt::entity entity = registry->create();
 	registry->emplace<Platform>(entity);
-	registry->emplace<Rect>(entity, position, dimensions);
+	registry->emplace<Transform>(entity, position, dimensions);
+	registry->emplace<PrevTransform>(entity, position);
 	registry->emplace<Sprite>(entity, platform_texture);
 	registry->emplace<Collider>(entity);
 	return entity;
 }
 
-entt::entity Arcanoid::spawn_pickup(entt::registry* registry, SDL_Texture* pickup_texture)
+entt::entity Arcanoid::spawn_pickup(entt::registry* registry, const Bounds& game_bounds, const TextureRegion& pickup_texture, Random& random)
 {
-	// Random generators for x position and pickup type
-	static std::default_random_engine gen(SDL_GetTicks());
-	static std::uniform_int_distribution<int> rand_x((int)m_game_bounds.min.x, (int)m_game_bounds.max.x);
-	static std::uniform_int_distribution<int> rand_t(0, (int)EPickupType::number - 1);
+	// Random x position and pickup type
+	std::uniform_int_distribution<int> rand_x((int)game_bounds.min.x, (int)game_bounds.max.x);
+	std::uniform_int_distribution<int> rand_t(0, (int)EPickupType::number - 1);
 
-	const Vector2 position{ (float)rand_x(gen), 0 };
+	const Vector2 position{ (float)rand_x(random), 0 };
 	const Vector2 dimensions{ 20, 20 };
 
 	entt::entity entity = registry->create();
-	registry->emplace<Pickup>(entity, (EPickupType)rand_t(gen));
-	registry->emplace<Rect>(entity, position, dimensions);
+	registry->emplace<Pickup>(entity, (EPickupType)rand_t(random));
+	registry->emplace<Transform>(entity, position, dimensions);
+	registry->emplace<PrevTransform>(entity, position);
 	registry->emplace<Sprite>(entity, pickup_texture);
 	registry->emplace<Collider>(entity);
 	registry->emplace<Movable>(entity, Vector2 { 0, 320 });
 	return entity;
 }
 
-entt::entity Arcanoid::spawn_ball(entt::registry* registry, const Vector2& position, const Vector2 velocity, SDL_Texture* platform_texture)
+entt::entity Arcanoid::spawn_ball(entt::registry* registry, const Vector2& position, const Vector2 velocity, const TextureRegion& platform_texture)
 {
 	// Create ball in the middle of the platform, slightly above
 	entt::entity entity = registry->create();
 	registry->emplace<Ball>(entity);
-	registry->emplace<Circle>(entity, position, g_ball_radius);
+	registry->emplace<Transform>(entity, fmath::circle_to_transform({ position, g_ball_radius }));
+	registry->emplace<PrevTransform>(entity, position);
 	registry->emplace<Sprite>(entity, platform_texture);
 	registry->emplace<Collider>(entity);
 	registry->emplace<Movable>(entity, velocity);
 	return entity;
 }
 
-entt::entity Arcanoid::spawn_laser(entt::registry* registry, entt::entity platform_entity, SDL_Texture* laser_texture)
+void BallSpawn::spawn(entt::registry& registry, const BallSpawn* const* items, size_t count)
+{
+	std::vector<entt::entity> entities(count);
+	registry.create(entities.begin(), entities.end());
+
+	std::vector<Transform>     transforms;
+	std::vector<PrevTransform> prev_transforms;
+	std::vector<Sprite>        sprites;
+	std::vector<Movable>       movables;
+	transforms.reserve(count);
+	prev_transforms.reserve(count);
+	sprites.reserve(count);
+	movables.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		transforms.push_back(fmath::circle_to_transform({ items[i]->position, g_ball_radius }));
+		prev_transforms.push_back({ items[i]->position });
+		sprites.push_back({ items[i]->region });
+		movables.push_back({ items[i]->velocity });
+	}
+
+	registry.insert<Ball>(entities.begin(), entities.end());
+	registry.insert<Transform>(entities.begin(), entities.end(), transforms.begin(), transforms.end());
+	registry.insert<PrevTransform>(entities.begin(), entities.end(), prev_transforms.begin(), prev_transforms.end());
+	registry.insert<Sprite>(entities.begin(), entities.end(), sprites.begin(), sprites.end());
+	registry.insert<Collider>(entities.begin(), entities.end());
+	registry.insert<Movable>(entities.begin(), entities.end(), movables.begin(), movables.end());
+}
+
+entt::entity Arcanoid::spawn_laser(entt::registry* registry, const Bounds& game_bounds, entt::entity platform_entity, const TextureRegion& laser_texture)
 {
-	Rect& platform = registry->get<Rect>(platform_entity);
+	Transform& platform = registry->get<Transform>(platform_entity);
 
-	const Vector2 position { platform.position.x, platform.position.y - g_game_area_s.y / 2 };
-	const Vector2 dimensions{ 15 * g_scale, g_game_area_s.y };
+	const float   height{ game_bounds.max.y - game_bounds.min.y };
+	const Vector2 position { platform.position.x, platform.position.y - height / 2 };
+	const Vector2 dimensions{ 15 * g_scale, height };
 
 	entt::entity entity = registry->create();
-	registry->emplace<Rect>(entity, position, dimensions);
+	registry->emplace<Transform>(entity, position, dimensions);
+	registry->emplace<PrevTransform>(entity, position);
 	registry->emplace<Sprite>(entity, laser_texture);
 	registry->emplace<Laser>(entity);
-	registry->emplace<Attach>(entity, platform_entity, Vector2{ 0.0f, -g_game_area_s.y / 2 });
+	registry->emplace<Attach>(entity, platform_entity, Vector2{ 0.0f, -height / 2 });
 	return entity;
 }
 
 void Arcanoid::spawn_random_pickup()
 {
-	spawn_pickup(m_registry, res.tex_pickup);
-	m_scheduler->schedule(5, std::bind(&Arcanoid::spawn_random_pickup, this));
+	spawn_pickup(m_registry, m_game_bounds, res.tex_pickup, m_random);
+	m_scheduler->schedule(5, [this]() { spawn_random_pickup(); });
 }
 
 void Arcanoid::reset_to_start(bool full)
@@ -206,6 +504,7 @@ void Arcanoid::reset_to_start(bool full)
 	if (full)
 	{
 		m_registry->clear();
+		m_block_grid.clear();
 	}
 	else
 	{
@@ -214,24 +513,24 @@ void Arcanoid::reset_to_start(bool full)
 	}
 	
 	m_scheduler->reset();
-	m_scheduler->schedule(5, std::bind(&Arcanoid::spawn_random_pickup, this));
+	m_scheduler->schedule(5, [this]() { spawn_random_pickup(); });
 
 	if (m_registry->size<Platform>() == 0)
 	{
-		m_platform = spawn_platform(m_registry, res.tex_platform);
+		m_platform = spawn_platform(m_registry, m_game_bounds, res.tex_platform);
 	}
 	else
 	{
-		auto platform_view = m_registry->view<Platform, Rect>();
+		auto platform_view = m_registry->view<Platform, Transform>();
 		for (auto [entity, rect] : platform_view.each()) {
-			rect.position.x = g_game_center_s.x;
-			rect.position.y = g_game_area_s.y - g_platform_elevation;
 			rect.dimensions = g_platform_dimensions;
+			teleport_entity(m_registry, entity, get_platform_start(m_game_bounds));
 		}
 	}
 
-	const float platform_top = g_game_area_s.y - g_platform_elevation - g_platform_dimensions.y / 2;
-	const Vector2 ball_position{ g_game_center_s.x,  platform_top - g_ball_radius - 5 * g_scale };
+	const Vector2 platform_start{ get_platform_start(m_game_bounds) };
+	const float   platform_top = platform_start.y - g_platform_dimensions.y / 2;
+	const Vector2 ball_position{ platform_start.x,  platform_top - g_ball_radius - 5 * g_scale };
 
 	m_aim_ball = spawn_ball(m_registry, ball_position, { 0, -g_ball_start_velocity }, res.tex_ball);
 	m_state = EGameState::game_aim;
@@ -251,7 +550,7 @@ void Arcanoid::check_win_conditions()
 		{
 			if (!is_waiting_for_next_level)
 			{
-				Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_FAILURE], 0);
+				m_audio.push(EHITSOUND_FAILURE);
 			}
 
 			is_waiting_for_restart    = true;
@@ -267,6 +566,80 @@ void Arcanoid::check_win_conditions()
 	}
 }
 
+void Arcanoid::update_autoplay()
+{
+	switch (m_state)
+	{
+	case EGameState::game_aim:
+	case EGameState::score:
+		// Launch the ball or restart the game
+		on_input(EInputEvent::space, true);
+		break;
+	case EGameState::game:
+		{
+			if (!m_registry->valid(m_platform))
+			{
+				break;
+			}
+
+			// Follow the lowest ball
+			const Transform& platform = m_registry->get<Transform>(m_platform);
+			const Transform* lowest = nullptr;
+			auto ball_view = m_registry->view<Ball, Transform>();
+			for (auto [entity, ball] : ball_view.each())
+			{
+				if (lowest == nullptr || ball.position.y > lowest->position.y)
+				{
+					lowest = &ball;
+				}
+			}
+
+			if (lowest == nullptr)
+			{
+				break;
+			}
+
+			const float delta_x = lowest->position.x - platform.position.x;
+			if (fabsf(delta_x) > platform.dimensions.x / 4)
+			{
+				on_input(delta_x < 0 ? EInputEvent::left : EInputEvent::right, false);
+			}
+		}
+		break;
+	case EGameState::pause:
+		break;
+	}
+}
+
+void Arcanoid::register_systems()
+{
+	// Registration order is the order conflicting systems run in.
+	// Structural changes go through m_commands, so no system touches the entity set directly.
+	m_systems.add("balls",
+		SystemAccess{}.read<Ball, Block, BlockGridAccess, PlatformMotion>().write<BallMotion, Life, Sprite, RandomAccess>(),
+		[this]() { update_balls(m_registry, m_game_bounds, m_platform, m_block_grid, res, m_thread_pool.get(), m_ball_scratch, m_commands, m_audio, m_random); });
+
+	m_systems.add("laser",
+		SystemAccess{}.read<Laser, Attach, Block, BlockGridAccess, AttachedMotion>().write<Life>(),
+		[this]() { update_laser(m_registry, m_block_grid); });
+
+	m_systems.add("lifes",
+		SystemAccess{}.read<Life, Block>().write<PlayerStateAccess>(),
+		[this]() { update_lifes(m_registry, m_player_state, m_commands); });
+
+	m_systems.add("pickups",
+		SystemAccess{}.read<Pickup, Collider, Ball, Sprite, BallMotion, PickupMotion>().write<PlatformMotion, SchedulerAccess>(),
+		[this]() { update_pickups(m_registry, m_game_bounds, m_scheduler, m_platform, res, m_commands, m_audio); });
+
+	m_systems.add("movable",
+		SystemAccess{}.read<Ball>().write<PickupMotion>(),
+		[this]() { update_movable(m_registry); });
+
+	m_systems.add("attach",
+		SystemAccess{}.read<Attach, PlatformMotion>().write<AttachedMotion>(),
+		[this]() { update_attach(m_registry, m_commands); });
+}
+
 bool Arcanoid::progress_to_next_level()
 {
 	reset_to_start(true);
@@ -278,59 +651,359 @@ void Arcanoid::reset_player_state()
 	m_player_state = {};
 }
 
+// Everything around the registry that a snapshot restores
+struct SavedGameState
+{
+	uint32_t     version;
+	EGameState   state;
+	PlayerState  player_state;
+	entt::entity platform;
+	entt::entity aim_ball;
+	bool         is_restart_allowed;
+	bool         is_restart_requested;
+	bool         is_waiting_for_next_level;
+	bool         is_waiting_for_restart;
+};
+
+static constexpr uint32_t c_saved_game_state_version = 1;
+
+// Archives of entt::snapshot and entt::snapshot_loader.
+// Components are copied as raw bytes, sprites are reduced to a resource id and an 8 bit alpha.
+class SnapshotWriter final
+{
+private:
+	std::vector<uint8_t>& m_data;
+	const Resources&      m_res;
+
+public:
+	template<class t>
+	void write(const t& value)
+	{
+		static_assert(std::is_trivially_copyable_v<t>, "Snapshot data is copied as raw bytes");
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		m_data.insert(m_data.end(), bytes, bytes + sizeof(t));
+	}
+
+	void operator()(entt::entity entity)
+	{
+		write(entity);
+	}
+
+	void operator()(std::underlying_type_t<entt::entity> count)
+	{
+		write(count);
+	}
+
+	template<class component>
+	void operator()(entt::entity entity, const component& value)
+	{
+		write(entity);
+		write(value);
+	}
+
+	void operator()(entt::entity entity, const Sprite& sprite)
+	{
+		write(entity);
+		write(m_res.get_sprite_id(sprite.region));
+		write((uint8_t)(fmath::clamp(sprite.alpha, 0.0f, 1.0f) * 255.0f + 0.5f));
+	}
+
+	SnapshotWriter(std::vector<uint8_t>& data, const Resources& res) : m_data(data), m_res(res)
+	{
+	}
+};
+
+class SnapshotReader final
+{
+private:
+	const std::vector<uint8_t>& m_data;
+	const Resources&            m_res;
+	size_t                      m_offset{ 0 };
+	bool                        m_failed{ false };
+
+public:
+	// Reads zeros past the end and remembers it
+	template<class t>
+	void read(t& value)
+	{
+		static_assert(std::is_trivially_copyable_v<t>, "Snapshot data is copied as raw bytes");
+		if (m_failed || m_data.size() - m_offset < sizeof(t))
+		{
+			m_failed = true;
+			value    = t{};
+			return;
+		}
+		memcpy(&value, m_data.data() + m_offset, sizeof(t));
+		m_offset += sizeof(t);
+	}
+
+	bool is_failed() const
+	{
+		return m_failed;
+	}
+
+	void operator()(entt::entity& entity)
+	{
+		read(entity);
+	}
+
+	void operator()(std::underlying_type_t<entt::entity>& count)
+	{
+		read(count);
+
+		// Nothing is smaller than an entity, a larger count can only come from a damaged buffer
+		if (count > (m_data.size() - m_offset) / sizeof(entt::entity))
+		{
+			m_failed = true;
+			count    = 0;
+		}
+	}
+
+	template<class component>
+	void operator()(entt::entity& entity, component& value)
+	{
+		read(entity);
+		read(value);
+	}
+
+	void operator()(entt::entity& entity, Sprite& sprite)
+	{
+		uint16_t id    = 0;
+		uint8_t  alpha = 0;
+		read(entity);
+		read(id);
+		read(alpha);
+		sprite.region = m_res.get_sprite(id);
+		sprite.alpha  = alpha / 255.0f;
+	}
+
+	SnapshotReader(const std::vector<uint8_t>& data, const Resources& res) : m_data(data), m_res(res)
+	{
+	}
+};
+
+// One list for saving and loading, order is part of the format
+template<class snapshot_t, class archive_t>
+static void snapshot_components(const snapshot_t& snapshot, archive_t& archive)
+{
+	snapshot.entities(archive).template component<Transform, PrevTransform, Sprite, Movable, Life, Pickup, Collider, Block, Platform, Ball, Destroy, Laser, Attach>(archive);
+}
+
+void Arcanoid::save_state(GameSnapshot& snapshot) const
+{
+	snapshot.clear();
+	SnapshotWriter writer{ snapshot.data, res };
+
+	SavedGameState state{};
+	state.version                   = c_saved_game_state_version;
+	state.state                     = m_state;
+	state.player_state              = m_player_state;
+	state.platform                  = m_platform;
+	state.aim_ball                  = m_aim_ball;
+	state.is_restart_allowed        = is_restart_allowed;
+	state.is_restart_requested      = is_restart_requested;
+	state.is_waiting_for_next_level = is_waiting_for_next_level;
+	state.is_waiting_for_restart    = is_waiting_for_restart;
+	writer.write(state);
+
+	snapshot_components(entt::snapshot{ *m_registry }, writer);
+}
+
+bool Arcanoid::load_state(const GameSnapshot& snapshot, bool with_player_state)
+{
+	SnapshotReader reader{ snapshot.data, res };
+
+	SavedGameState state{};
+	reader.read(state);
+	if (reader.is_failed() || state.version != c_saved_game_state_version)
+	{
+		return false;
+	}
+
+	m_registry->clear();
+	m_commands.clear();
+
+	// The loader expects an empty registry when it is constructed
+	const entt::snapshot_loader loader{ *m_registry };
+	snapshot_components(loader, reader);
+	if (reader.is_failed())
+	{
+		m_registry->clear();
+		m_block_grid.clear();
+		return false;
+	}
+	loader.orphans();
+
+	// Grid and timers aren't part of the snapshot
+	m_block_grid.rebuild(m_registry);
+
+	// Timed power-ups would never expire without their timers, so they end on load
+	auto platform_view = m_registry->view<Platform, Transform>();
+	for (auto [entity, rect] : platform_view.each())
+	{
+		rect.dimensions = g_platform_dimensions;
+	}
+
+	auto laser_view = m_registry->view<Laser>();
+	m_registry->destroy(laser_view.begin(), laser_view.end());
+
+	m_scheduler->reset();
+	m_scheduler->schedule(5, [this]() { spawn_random_pickup(); });
+
+	m_state                   = state.state;
+	m_platform                = state.platform;
+	m_aim_ball                = state.aim_ball;
+	is_restart_allowed        = state.is_restart_allowed;
+	is_restart_requested      = state.is_restart_requested;
+	is_waiting_for_next_level = state.is_waiting_for_next_level;
+	is_waiting_for_restart    = state.is_waiting_for_restart;
+	if (with_player_state)
+	{
+		m_player_state = state.player_state;
+	}
+	return true;
+}
+
 void Arcanoid::on_construct(SDL_Renderer* renderer, entt::registry* registry)
 {
 	m_registry = registry;
+	prepare_registry(m_registry);
+
+	register_systems();
 
 	// Load resources
-	res.construct(renderer, registry);
+	res.construct(renderer, registry, *m_thread_pool);
+	m_text_renderer.construct(renderer, res.ttf_font);
+
+	// Start game
+	reset_to_start(true);
+}
+
+void Arcanoid::register_audio()
+{
+	// Higher wins when a frame asks for more sounds than the voice budget
+	constexpr uint8_t hitsound_priorities[EHITSOUND_NUMBER]{
+		1, // touch
+		3, // break
+		0, // walls
+		2, // platform
+		4, // bonus
+		2, // ground
+		5, // failure
+		4, // laser on
+	};
+
+	for (size_t i = 0; i < EHITSOUND_NUMBER; ++i)
+	{
+		m_audio.set_sound((uint8_t)i, res.mix_hit[i], hitsound_priorities[i]);
+	}
 
 	if (res.music)
 	{
 		Mix_PlayMusic(res.music, -1);
 	}
-
-	// Start game
-	reset_to_start(true);
 }
 
 void Arcanoid::on_update(float delta_time)
 {
+	// Game starts before the sounds are loaded, it stays silent until then
+	if (!m_is_audio_registered && res.is_audio_ready())
+	{
+		register_audio();
+		m_is_audio_registered = true;
+	}
+
+	m_audio.end_frame();
 }
 
 void Arcanoid::on_fixed_update()
 {
+	// Whatever moves from here on is blended in by render_sprites
+	update_prev_transforms(m_registry);
+
+	if (is_autoplay)
+	{
+		update_autoplay();
+	}
+
 	m_scheduler->pause(m_state != EGameState::game);
 	if (m_state == EGameState::game)
 	{
-		update_balls(m_registry, m_platform, res);
-		update_laser(m_registry);
-		update_lifes(m_registry, m_player_state);
-		update_pickups(m_registry, m_scheduler, m_platform, res);
-		update_movable(m_registry);
-		update_attach(m_registry);
-		update_destroys(m_registry);
+		{
+			PROFILE_ZONE("SystemGraph::run");
+			m_systems.run(*m_thread_pool);
+		}
+
+		// Sync point, spawns and Destroy tags recorded by the systems
+		{
+			PROFILE_ZONE("CommandBuffer::flush");
+			m_commands.flush(*m_registry);
+		}
+
+		{
+			PROFILE_ZONE("update_destroys");
+			update_destroys(m_registry, m_block_grid, m_commands);
+			m_commands.flush(*m_registry);
+		}
 
 		check_win_conditions();
 	}
 }
 
-void Arcanoid::on_render(SDL_Renderer* renderer)
+void Arcanoid::on_render(SDL_Renderer* renderer, float blend)
+{
+	m_snapshot.clear();
+	on_snapshot(m_snapshot, blend);
+	on_render_snapshot(renderer, m_snapshot);
+}
+
+void Arcanoid::on_snapshot(RenderSnapshot& snapshot, float blend)
 {
 	switch (m_state)
 	{
 	case EGameState::game_aim:
-		render_space_hint(renderer, res.ttf_font);
+		render_space_hint(snapshot);
 		[[fallthrough]];
 	case EGameState::game:
 	case EGameState::pause:
-		render_sprites(m_registry, renderer);
-		render_player_state(renderer, res.ttf_font, m_player_state);
+		{
+			PROFILE_ZONE("render_sprites");
+			render_sprites(m_registry, snapshot, blend);
+		}
+		{
+			PROFILE_ZONE("render_player_state");
+			render_player_state(snapshot, m_player_state);
+		}
 		break;
 	case EGameState::score:
-		render_final_score(renderer, res.ttf_font, m_player_state);
+		render_final_score(snapshot, m_player_state);
 		break;
 	}
+
+	if (is_profile_overlay)
+	{
+		render_profile_overlay(snapshot);
+	}
+}
+
+void Arcanoid::on_render_snapshot(SDL_Renderer* renderer, const RenderSnapshot& snapshot)
+{
+	{
+		PROFILE_ZONE("draw sprites");
+		for (const SnapshotSprite& sprite : snapshot.sprites)
+		{
+			m_sprite_batch.add(sprite.region, sprite.rect, sprite.alpha);
+		}
+		m_sprite_batch.flush(renderer);
+	}
+
+	{
+		PROFILE_ZONE("draw text");
+		for (size_t i = 0; i < snapshot.text_count; ++i)
+		{
+			m_text_renderer.draw(renderer, snapshot.texts[i].text.c_str(), snapshot.texts[i].target);
+		}
+	}
 }
 
 void Arcanoid::on_input(EInputEvent e, bool changed)
@@ -343,18 +1016,19 @@ void Arcanoid::on_input(EInputEvent e, bool changed)
 		}
 
 		constexpr float ball_velocity = 120.0f * (float)g_scale * (float)g_fixed_delta_time;
-		Rect&    platform = m_registry->get<Rect>(m_platform);
-		Circle&  ball     = m_registry->get<Circle>(m_aim_ball);
-		Movable& ball_mov = m_registry->get<Movable>(m_aim_ball);
+		Transform& platform = m_registry->get<Transform>(m_platform);
+		Transform& ball     = m_registry->get<Transform>(m_aim_ball);
+		Movable&   ball_mov = m_registry->get<Movable>(m_aim_ball);
 
-		const Bounds plbounds = fmath::rect_to_bounds(platform);
+		const Bounds plbounds = fmath::rect_to_bounds(fmath::transform_to_rect(platform));
+		const float  radius   = ball.dimensions.x / 2.0f;
 		switch (e)
 		{
 		case EInputEvent::left:
-			ball.position.x = ball.position.x - ball.radius > plbounds.min.x ? ball.position.x - ball_velocity : ball.position.x;
+			ball.position.x = ball.position.x - radius > plbounds.min.x ? ball.position.x - ball_velocity : ball.position.x;
 			break;
 		case EInputEvent::right:
-			ball.position.x = ball.position.x + ball.radius < plbounds.max.x ? ball.position.x + ball_velocity : ball.position.x;
+			ball.position.x = ball.position.x + radius < plbounds.max.x ? ball.position.x + ball_velocity : ball.position.x;
 			break;
 		case EInputEvent::space:
 			{
@@ -370,7 +1044,7 @@ void Arcanoid::on_input(EInputEvent e, bool changed)
 	}
 	else if (m_state == EGameState::game)
 	{
-		Rect& platform = m_registry->get<Rect>(m_platform);
+		Transform& platform = m_registry->get<Transform>(m_platform);
 
 		constexpr float platform_velocity = g_platform_velocity * (float) g_fixed_delta_time;
 		const Bounds gabounds = fmath::rect_to_bounds(m_game_area);
@@ -411,44 +1085,74 @@ void Arcanoid::on_input(EInputEvent e, bool changed)
 	}
 }
 
+bool Arcanoid::is_idle() const
+{
+	// Paused and score screens only change on a key press
+	return !is_autoplay && (m_state == EGameState::pause || m_state == EGameState::score);
+}
+
+void Arcanoid::prepare_registry(entt::registry* registry)
+{
+	// Create groups before any entity exists, so they never have to be sorted
+	get_sprite_group(registry);
+	get_movable_group(registry);
+	get_block_group(registry);
+	prepare_pools<Transform, PrevTransform, Sprite, Movable, Life, Pickup, Collider, Block, Platform, Ball, Destroy, Laser, Attach>(registry);
+}
+
 Vector2 Arcanoid::get_entity_position(entt::registry* registry, entt::entity entity)
 {
-	// We have 2 types of dimensions, one for Circle and other for Rect
-	Vector2 position{ NAN, NAN };
-	if (Rect* rect = registry->try_get<Rect>(entity))
-	{
-		position = rect->position;
-	}
-	else if (Circle* circle = registry->try_get<Circle>(entity))
+	if (const Transform* transform = registry->try_get<Transform>(entity))
 	{
-		position = fmath::circle_to_rect(*circle).position;
+		return transform->position;
 	}
 
-	return position;
+	return { NAN, NAN };
 }
 
 bool Arcanoid::set_entity_position(entt::registry* registry, entt::entity entity, Vector2 position)
 {
-	if (Rect* rect = registry->try_get<Rect>(entity))
+	if (Transform* transform = registry->try_get<Transform>(entity))
 	{
-		rect->position = position;
+		transform->position = position;
 		return true;
 	}
-	else if (Circle* circle = registry->try_get<Circle>(entity))
+
+	return false;
+}
+
+bool Arcanoid::teleport_entity(entt::registry* registry, entt::entity entity, Vector2 position)
+{
+	if (!set_entity_position(registry, entity, position))
 	{
-		circle->position = position;
-		return true;
+		return false;
 	}
 
-	return false;
+	if (PrevTransform* prev = registry->try_get<PrevTransform>(entity))
+	{
+		prev->position = position;
+	}
+	return true;
 }
 
-Arcanoid::Arcanoid(std::shared_ptr<Scheduler> scheduler) : m_scheduler(scheduler)
+const PlayerState& Arcanoid::get_player_state() const
+{
+	return m_player_state;
+}
+
+const entt::registry& Arcanoid::get_registry() const
+{
+	return *m_registry;
+}
+
+Arcanoid::Arcanoid(std::shared_ptr<Scheduler> scheduler, std::shared_ptr<ThreadPool> thread_pool, uint64_t seed) : m_scheduler(scheduler), m_thread_pool(thread_pool), m_commands(thread_pool.get()), m_random((Random::result_type)seed)
 {
 }
 
 Arcanoid::~Arcanoid()
 {
+	// Loads still in flight write into res
+	m_thread_pool->wait(res.audio_pending);
 }
 
 void Arcanoid::remove_balls(entt::registry* registry)
@@ -475,157 +1179,295 @@ void Arcanoid::remove_pickups(entt::registry* registry)
 	}
 }
 
-void Arcanoid::update_balls(entt::registry* registry, entt::entity platform_entity, Resources& res)
+void Arcanoid::update_balls(entt::registry* registry, const Bounds& game_bounds, entt::entity platform_entity, const BlockGrid& block_grid, Resources& res, ThreadPool* thread_pool, BallScratch& scratch, CommandBuffer& commands, AudioQueue& audio, Random& random)
 {
 	Rect platform{};
-	if (registry->has<Rect>(platform_entity))
+	if (registry->has<Transform>(platform_entity))
 	{
-		platform = registry->get<Rect>(platform_entity);
+		platform = fmath::transform_to_rect(registry->get<Transform>(platform_entity));
 	}
-	
-	auto ball_view  = registry->view<Ball, Circle, Movable, Collider>();
-	for (auto [entity, ball, ball_mov] : ball_view.each())
+	const Bounds platform_bounds{ fmath::rect_to_bounds(platform) };
+
+	enum class EContact
 	{
-		// Ball cannot exit game area
-		ball.position = { fmath::clamp(ball.position.x, m_game_bounds.min.x, m_game_bounds.max.x), fmath::clamp(ball.position.y, m_game_bounds.min.y, m_game_bounds.max.y) };
+		none,
+		wall,
+		ground,
+		block,
+		platform
+	};
 
-		// We want to check against predicted position of the ball
-		const Circle ball_nf{ ball.position + ball_mov.velocity * (float)g_fixed_delta_time, ball.radius };
+	struct Contact
+	{
+		EContact     type{ EContact::none };
+		float        toi{ 1.0f };
+		Vector2      normal{};
+		entt::entity block{ entt::null };
+	};
 
-		// Check the ball against the walls
-		if (ball_nf.position.y < m_game_bounds.min.y)
-		{
-			Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_WALLS], 0);
-			ball_mov.velocity.y *= -1;
-		}
-		if (ball_nf.position.y > m_game_bounds.max.y || isnan(ball_nf.position.x) || isnan(ball_nf.position.y))
-		{
-			Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_GROUND], 0);
-			// Mark for destruction and continue with next ball
-			registry->emplace<Destroy>(entity);
-			continue;
-		}
+	auto ball_view  = registry->view<Ball, Transform, Movable, Collider>();
 
-		if (ball_nf.position.x < m_game_bounds.min.x || ball_nf.position.x > m_game_bounds.max.x)
-		{
-			Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_WALLS], 0);
-			ball_mov.velocity.x *= -1;
-		}
+	scratch.balls.clear();
+	for (entt::entity entity : ball_view)
+	{
+		scratch.balls.push_back(entity);
+	}
 
-		const float magnitude = fmath::magnitude(ball_mov.velocity);
-		const Vector2 direction = ball_mov.velocity / magnitude;
+	const size_t chunk_count = (scratch.balls.size() + g_ball_chunk_size - 1) / g_ball_chunk_size;
+	if (scratch.chunks.size() < chunk_count)
+	{
+		scratch.chunks.resize(chunk_count);
+	}
 
-		// We want to keep our ball faster than certain amount
-		if (magnitude < g_ball_start_velocity)
-		{
-			ball_mov.velocity = direction * g_ball_start_velocity;
-		}
+	// Only touches its own balls, everything else is recorded as events
+	const auto simulate_chunk = [&](size_t chunk)
+	{
+		PROFILE_ZONE("update_balls chunk");
 
-		// We want to avoid right angle for our ball
-		if (fabs(direction.x) > 0.9 || fabs(direction.y) > 0.98)
-		{
-			ball_mov.velocity = fmath::rotated(ball_mov.velocity, std::copysign(1.0f, direction.x) * fmath::conv_to_rad);
-		}
+		std::vector<BallEvent>& events = scratch.chunks[chunk];
+		events.clear();
 
-		auto block_view = registry->view<Block, Rect, Life, Collider>();
-		for (auto [entity, block, block_life] : block_view.each())
+		const size_t first = chunk * g_ball_chunk_size;
+		const size_t last  = std::min(first + g_ball_chunk_size, scratch.balls.size());
+		for (size_t ball_index = first; ball_index < last; ++ball_index)
 		{
-			if (!fmath::has_intersection(ball_nf, block))
+			const entt::entity entity = scratch.balls[ball_index];
+			Transform& ball_transform = ball_view.get<Transform>(entity);
+			Movable&   ball_mov       = ball_view.get<Movable>(entity);
+			Circle     ball{ fmath::transform_to_circle(ball_transform) };
+
+			// Ball cannot exit game area
+			ball.position = { fmath::clamp(ball.position.x, game_bounds.min.x, game_bounds.max.x), fmath::clamp(ball.position.y, game_bounds.min.y, game_bounds.max.y) };
+
+			ball_transform.position = ball.position;
+
+			if (isnan(ball.position.x) || isnan(ball.position.y))
 			{
+				events.push_back({ EBallEvent::destroy, entity });
 				continue;
 			}
 
-			Vector2 delta = ball.position - block.position;
-			if (fabsf(delta.y) < block.dimensions.y)
-			{
-				ball_mov.velocity.x *= -1;
-			}
-			else if (fabsf(delta.x) < block.dimensions.x)
-			{
-				ball_mov.velocity.y *= -1;
-			}
-			else if (fabsf(delta.y) > fabsf(delta.x))
-			{
-				ball_mov.velocity.x *= -1;
-			}
-			else
+			const float magnitude = fmath::magnitude(ball_mov.velocity);
+			const Vector2 direction = ball_mov.velocity / magnitude;
+
+			// We want to keep our ball faster than certain amount
+			if (magnitude < g_ball_start_velocity)
 			{
-				ball_mov.velocity.y *= -1;
+				ball_mov.velocity = direction * g_ball_start_velocity;
 			}
 
-			// Random generators for cracks
-			if (Sprite* sprite = registry->try_get<Sprite>(entity))
+			// We want to avoid right angle for our ball
+			if (fabs(direction.x) > 0.9 || fabs(direction.y) > 0.98)
 			{
-				static std::default_random_engine gen(SDL_GetTicks());
-				static std::uniform_int_distribution<int> index(0, ECRACKCOLOR_NUMBER - 1);
-				sprite->texture = res.tex_crack[index(gen)];
+				ball_mov.velocity = fmath::rotated(ball_mov.velocity, std::copysign(1.0f, direction.x) * fmath::conv_to_rad);
 			}
-			
-			// One hit is 1 HP
-			block_life.life -= 1;
 
-			// Play sound
-			if (block_life.life > 0)
+			// Move the ball through the whole step, resolving contacts in time order,
+			// so fast balls can bounce several times per step without tunneling through blocks
+			float remaining = 1.0f;
+			bool  destroyed = false;
+			for (uint32_t bounce = 0; bounce < g_ball_max_bounces && remaining > 0.0f; ++bounce)
 			{
-				Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_TOUCH], 0);
+				const Vector2 delta{ ball_mov.velocity * (float)g_fixed_delta_time * remaining };
+				const Vector2 target{ ball.position + delta };
+
+				Contact contact;
+
+				// Walls and ground only stop the center of the ball
+				if (delta.x < 0.0f && target.x < game_bounds.min.x)
+				{
+					contact = { EContact::wall, (game_bounds.min.x - ball.position.x) / delta.x, { 1, 0 } };
+				}
+				else if (delta.x > 0.0f && target.x > game_bounds.max.x)
+				{
+					contact = { EContact::wall, (game_bounds.max.x - ball.position.x) / delta.x, { -1, 0 } };
+				}
+
+				if (delta.y < 0.0f && target.y < game_bounds.min.y)
+				{
+					const float toi = (game_bounds.min.y - ball.position.y) / delta.y;
+					if (toi < contact.toi)
+					{
+						contact = { EContact::wall, toi, { 0, 1 } };
+					}
+				}
+				else if (delta.y > 0.0f && target.y > game_bounds.max.y)
+				{
+					const float toi = (game_bounds.max.y - ball.position.y) / delta.y;
+					if (toi < contact.toi)
+					{
+						contact = { EContact::ground, toi, { 0, -1 } };
+					}
+				}
+
+				// Blocks touching the circle that bounds the whole path, tested in batches
+				const Circle path{ ball.position + delta / 2.0f, ball.radius + fmath::magnitude(delta) / 2.0f };
+				block_grid.query(path, [&](entt::entity block_entity, const Bounds& block_bounds)
+				{
+					float   toi;
+					Vector2 normal;
+					if (fmath::sweep(ball, delta, block_bounds, toi, normal) && toi < contact.toi)
+					{
+						contact = { EContact::block, toi, normal, block_entity };
+					}
+					return true;
+				});
+
+				if (platform.dimensions.x > 0.0f)
+				{
+					float   toi;
+					Vector2 normal;
+					if (fmath::sweep(ball, delta, platform_bounds, toi, normal) && toi < contact.toi)
+					{
+						contact = { EContact::platform, toi, normal };
+					}
+				}
+
+				ball.position = ball.position + delta * contact.toi;
+				remaining    *= 1.0f - contact.toi;
+
+				switch (contact.type)
+				{
+				case EContact::none:
+					remaining = 0.0f;
+					break;
+				case EContact::wall:
+					audio.push(EHITSOUND_WALLS);
+					ball_mov.velocity = fmath::reflected(ball_mov.velocity, contact.normal);
+					break;
+				case EContact::ground:
+					audio.push(EHITSOUND_GROUND);
+					destroyed = true;
+					break;
+				case EContact::block:
+					{
+						ball_mov.velocity = fmath::reflected(ball_mov.velocity, contact.normal);
+						events.push_back({ EBallEvent::block_hit, contact.block });
+					}
+					break;
+				case EContact::platform:
+					{
+						audio.push(EHITSOUND_PLATFORM);
+						constexpr float platform_range = 100.0f * fmath::conv_to_rad / 2.0f;
+						const float delta_x = platform.position.x - ball.position.x;
+						ball_mov.velocity = fmath::proj_to_hemi(platform_range, delta_x, platform.dimensions.x) * g_ball_start_velocity;
+					}
+					break;
+				}
+
+				if (destroyed)
+				{
+					break;
+				}
 			}
-			else
+
+			ball_transform.position = ball.position;
+
+			if (destroyed)
 			{
-				Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_BREAK], 0);
+				// Mark for destruction and continue with next ball
+				events.push_back({ EBallEvent::destroy, entity });
 			}
-			break;
 		}
+	};
+
+	if (thread_pool && scratch.balls.size() >= g_ball_parallel_threshold)
+	{
+		thread_pool->parallel_for(chunk_count, simulate_chunk);
+	}
+	else
+	{
+		for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+		{
+			simulate_chunk(chunk);
+		}
+	}
 
-		if (fmath::has_intersection(ball_nf, platform))
+	// Chunks hold consecutive balls, so this is the order a single thread would have applied them in
+	for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+	{
+		for (const BallEvent& event : scratch.chunks[chunk])
 		{
-			Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_PLATFORM], 0);
-			constexpr float platform_range = 100.0f * fmath::conv_to_rad / 2.0f;
-			const float delta_x = platform.position.x - ball.position.x;
-			ball_mov.velocity = fmath::proj_to_hemi(platform_range, delta_x, platform.dimensions.x) * g_ball_start_velocity;
+			switch (event.type)
+			{
+			case EBallEvent::block_hit:
+				{
+					// Random crack, drawn in ball order so runs with the same seed match
+					if (Sprite* sprite = registry->try_get<Sprite>(event.entity))
+					{
+						std::uniform_int_distribution<int> index(0, ECRACKCOLOR_NUMBER - 1);
+						sprite->region = res.tex_crack[index(random)];
+					}
+
+					// One hit is 1 HP
+					Life& block_life = registry->get<Life>(event.entity);
+					block_life.life -= 1;
+
+					// Play sound
+					if (block_life.life > 0)
+					{
+						audio.push(EHITSOUND_TOUCH);
+					}
+					else
+					{
+						audio.push(EHITSOUND_BREAK);
+					}
+				}
+				break;
+			case EBallEvent::destroy:
+				commands.tag<Destroy>(event.entity);
+				break;
+			}
 		}
 	}
 }
 
-void Arcanoid::update_lifes(entt::registry* registry, PlayerState& player_state)
+void Arcanoid::update_lifes(entt::registry* registry, PlayerState& player_state, CommandBuffer& commands)
 {
-	auto block_view = registry->view<Block, Life>();
-	for (auto [entity, life] : block_view.each())
+	auto block_group = get_block_group(registry);
+	for (auto [entity, life, transform] : block_group.each())
 	{
 		constexpr float e = 1e-15F;
 		if (life.life < e)
 		{
 			player_state.score += life.reward;
-			registry->emplace<Destroy>(entity);
+			commands.tag<Destroy>(entity);
 		}
 	}
 }
 
-void Arcanoid::update_pickups(entt::registry* registry, std::shared_ptr<Scheduler> scheduler, entt::entity platform_entity, Resources& res)
+void Arcanoid::update_pickups(entt::registry* registry, const Bounds& game_bounds, std::shared_ptr<Scheduler> scheduler, entt::entity platform_entity, Resources& res, CommandBuffer& commands, AudioQueue& audio)
 {
-	Rect& platform = registry->get<Rect>(platform_entity);
+	if (!registry->has<Transform>(platform_entity))
+	{
+		return;
+	}
+
+	// Spawns are deferred to the command buffer, so references stay valid for the whole loop
+	Transform& platform = registry->get<Transform>(platform_entity);
 
-	auto pickup_view = registry->view<Rect, Pickup, Collider>();
+	auto pickup_view = registry->view<Transform, Pickup, Collider>();
 	for (auto [entity, rect, pickup] : pickup_view.each())
 	{
-		if (rect.position.y > m_game_bounds.max.y)
+		if (rect.position.y > game_bounds.max.y)
 		{
-			registry->emplace<Destroy>(entity);
+			commands.tag<Destroy>(entity);
 			continue;
 		}
 
-		if (fmath::has_intersection(rect, platform))
+		if (fmath::has_intersection(fmath::transform_to_rect(rect), fmath::transform_to_rect(platform)))
 		{
 			// Those pickups could be refactored into its own components
 			switch (pickup.type)
 			{
 			case EPickupType::platform_enlarge:
 				{
-					Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_BONUS], 0);
+					audio.push(EHITSOUND_BONUS);
 					platform.dimensions = { platform.dimensions.x + 30, platform.dimensions.y };
 					scheduler->schedule(5, [registry, platform_entity]() {
 						if (registry->valid(platform_entity))
 						{
-							Rect& platform = registry->get<Rect>(platform_entity);
+							Transform& platform = registry->get<Transform>(platform_entity);
 							platform.dimensions = { platform.dimensions.x - 30, platform.dimensions.y };
 						}
 					});
@@ -633,26 +1475,38 @@ void Arcanoid::update_pickups(entt::registry* registry, std::shared_ptr<Schedule
 				break;
 			case EPickupType::triplet:
 				{
-					Mix_PlayChannel(-1, res.mix_hit[EHITSOUND_BONUS], 0);
-					auto ball_view = registry->view<Ball, Circle, Sprite, Movable>();
-					for (auto [entity, circle, sprite, movable] : ball_view.each())
+					audio.push(EHITSOUND_BONUS);
+					auto ball_view = registry->view<Ball, Transform, Sprite, Movable>();
+					for (auto [entity, transform, sprite, movable] : ball_view.each())
 					{
 						// We process first entity, and then break
-						spawn_ball(registry, circle.position, fmath::rotated(movable.velocity,  17 * fmath::conv_to_rad), sprite.texture);
-						spawn_ball(registry, circle.position, fmath::rotated(movable.velocity, -17 * fmath::conv_to_rad), sprite.texture);
+						const Vector2 position{ transform.position };
+						const Vector2 velocity{ movable.velocity };
+						const TextureRegion texture{ sprite.region };
+						commands.spawn(BallSpawn{ position, fmath::rotated(velocity,  17 * fmath::conv_to_rad), texture });
+						commands.spawn(BallSpawn{ position, fmath::rotated(velocity, -17 * fmath::conv_to_rad), texture });
 						break;
 					}
 				}
 				break;
 			case EPickupType::laser:
 				{
-					Mix_PlayChannel(-1, res.mix_laser_on, 0);
-					entt::entity laser_entity = spawn_laser(registry, platform_entity, res.tex_laser);
-					scheduler->schedule(3, [registry, laser_entity]() {
-						if (registry->valid(laser_entity))
+					audio.push(EHITSOUND_LASER_ON);
+					// Expiry needs the laser entity, which only exists once the command runs
+					commands.custom([scheduler, game_bounds, platform_entity, texture = res.tex_laser](entt::registry& registry)
+					{
+						if (!registry.valid(platform_entity))
 						{
-							registry->destroy(laser_entity);
+							return;
 						}
+
+						entt::entity laser_entity = spawn_laser(&registry, game_bounds, platform_entity, texture);
+						scheduler->schedule(3, [registry = &registry, laser_entity]() {
+							if (registry->valid(laser_entity))
+							{
+								registry->destroy(laser_entity);
+							}
+						});
 					});
 				}
 				break;
@@ -660,58 +1514,64 @@ void Arcanoid::update_pickups(entt::registry* registry, std::shared_ptr<Schedule
 				break;
 			}
 
-			registry->emplace<Destroy>(entity);
+			commands.tag<Destroy>(entity);
 		}
 	}
 }
 
-void Arcanoid::update_destroys(entt::registry* registry)
+void Arcanoid::update_destroys(entt::registry* registry, BlockGrid& block_grid, CommandBuffer& commands)
 {
-	auto pickup_view = registry->view<Destroy>();
-	for (auto [entity] : pickup_view.each())
+	auto block_view = registry->view<Destroy, Block, Transform>();
+	for (auto [entity, transform] : block_view.each())
 	{
-		registry->destroy(entity);
+		block_grid.remove(entity, fmath::transform_to_rect(transform));
+	}
+
+	// Destroyed with one bulk call by the next flush
+	auto destroy_view = registry->view<Destroy>();
+	for (auto [entity] : destroy_view.each())
+	{
+		commands.destroy(entity);
 	}
 }
 
 void Arcanoid::update_movable(entt::registry* registry)
 {
-	auto circle_view = registry->view<Movable>();
-	for (auto [entity, mov] : circle_view.each())
+	// Balls are moved by update_balls, together with their collisions
+	auto movable_group = get_movable_group(registry);
+	for (auto [entity, mov, transform] : movable_group.each())
 	{
-		const Vector2 old_position{ get_entity_position(registry, entity) };
-		const Vector2 new_position{ old_position + mov.velocity * (float)g_fixed_delta_time };
-		set_entity_position(registry, entity, new_position);
+		transform.position = transform.position + mov.velocity * (float)g_fixed_delta_time;
 	}
 }
 
-void Arcanoid::update_laser(entt::registry* registry)
+void Arcanoid::update_laser(entt::registry* registry, const BlockGrid& block_grid)
 {
-	auto rect_view = registry->view<Rect, Laser, Attach>();
-	for (auto [entity, rect, attach] : rect_view.each())
+	auto rect_view = registry->view<Transform, Laser, Attach>();
+	for (auto [entity, transform, attach] : rect_view.each())
 	{
-		auto block_view = registry->view<Block, Rect, Life, Collider>();
-		for (auto [entity, block, block_life] : block_view.each())
+		// Laser is a full height strip, so this only visits the grid columns under it
+		const Bounds laser_bounds{ fmath::rect_to_bounds(fmath::transform_to_rect(transform)) };
+		block_grid.query(laser_bounds, [&](entt::entity block_entity, const Bounds& block_bounds)
 		{
-			if (!fmath::has_intersection(rect, block))
+			if (fmath::has_intersection(laser_bounds, block_bounds))
 			{
-				continue;
+				Life& block_life = registry->get<Life>(block_entity);
+				block_life.life -= 5.0f * (float) g_fixed_delta_time;
 			}
-
-			block_life.life -= 5.0f * (float) g_fixed_delta_time;
-			continue;
-		}
+			return true;
+		});
 	}
 }
 
-void Arcanoid::update_attach(entt::registry* registry)
+void Arcanoid::update_attach(entt::registry* registry, CommandBuffer& commands)
 {
 	auto rect_view = registry->view<Attach>();
 	for (auto [entity, attach] : rect_view.each())
 	{
 		if (!registry->valid(attach.parent)) 
 		{
-			registry->destroy(entity);
+			commands.destroy(entity);
 			continue;
 		}
 
@@ -720,41 +1580,32 @@ void Arcanoid::update_attach(entt::registry* registry)
 	}
 }
 
-void Arcanoid::render_sprites(entt::registry* registry, SDL_Renderer* renderer)
+void Arcanoid::update_prev_transforms(entt::registry* registry)
 {
-	auto rect_view = registry->view<Sprite>();
-	for (auto [entity, sprite] : rect_view.each())
+	auto prev_view = registry->view<PrevTransform, Transform>();
+	for (auto [entity, prev, transform] : prev_view.each())
 	{
-		// We have 2 types of dimensions, one for Circle and other for Rect
-		SDL_Rect sdlrect{};
-		if (Rect* rect = registry->try_get<Rect>(entity))
-		{
-			sdlrect = make_sdl_rect(*rect);
-		}
-		else if (Circle* circle = registry->try_get<Circle>(entity))
-		{
-			sdlrect = make_sdl_rect(*circle);
-		}
-		else
-		{
-			continue;
-		}
+		prev.position = transform.position;
+	}
+}
 
-		const uint8_t alpha = (uint8_t)sprite.alpha * 255;
-		if (sprite.texture == nullptr)
-		{
-			SDL_SetRenderDrawColor(renderer, 244, 244, 244, alpha);
-			SDL_RenderFillRect(renderer, &sdlrect);
-		}
-		else
+void Arcanoid::render_sprites(entt::registry* registry, RenderSnapshot& snapshot, float blend)
+{
+	auto sprite_group = get_sprite_group(registry);
+	auto prev_view    = registry->view<PrevTransform>();
+	snapshot.sprites.reserve(snapshot.sprites.size() + sprite_group.size());
+	for (auto [entity, transform, sprite] : sprite_group.each())
+	{
+		Rect rect = fmath::transform_to_rect(transform);
+		if (prev_view.contains(entity))
 		{
-			SDL_SetTextureAlphaMod(sprite.texture, alpha);
-			SDL_RenderCopy(renderer, sprite.texture, nullptr, &sdlrect);
+			rect.position = fmath::lerp(prev_view.get<PrevTransform>(entity).position, transform.position, blend);
 		}
+		snapshot.add_sprite(sprite.region, rect, sprite.alpha);
 	}
 }
 
-void Arcanoid::render_text(SDL_Renderer* renderer, TTF_Font* font, Vector2 offset, Vector2 anchor, const char* text)
+void Arcanoid::render_text(RenderSnapshot& snapshot, Vector2 offset, Vector2 anchor, const char* text)
 {
 	constexpr float char_height = 20.0f * g_scale;
 	constexpr float char_width  = 14.f  * g_scale;
@@ -765,44 +1616,64 @@ void Arcanoid::render_text(SDL_Renderer* renderer, TTF_Font* font, Vector2 offse
 
 	const Vector2 text_offset{ offset.x - text_width * (1 - anchor.x), offset.y - text_height / 2 * (1 - anchor.y) };
 	
-	SDL_Surface* surface = TTF_RenderText_Shaded(font, text, SDL_Color{ 255, 255, 255, 255 }, {});
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-	SDL_Rect r{ (int)text_offset.x, (int)text_offset.y, text_width, text_height };
-	SDL_RenderCopy(renderer, texture, nullptr, &r);
-	SDL_DestroyTexture(texture);
-	SDL_FreeSurface(surface);
+	const Vector2 text_min{ (float)(int)text_offset.x, (float)(int)text_offset.y };
+	snapshot.add_text({ text_min, text_min + Vector2{ (float)text_width, (float)text_height } }, text);
 }
 
-void Arcanoid::render_player_state(SDL_Renderer* renderer, TTF_Font* font, PlayerState& player_state)
+void Arcanoid::render_player_state(RenderSnapshot& snapshot, PlayerState& player_state)
 {
 	constexpr size_t max_text_size = 128;
 	char score_text[max_text_size];
-	sprintf_s(score_text, 128, "SCORE: %i", player_state.score);
-	render_text(renderer, font, { 14, 14 }, {1.0f, 0.5f}, score_text);
+	snprintf(score_text, max_text_size, "SCORE: %i", player_state.score);
+	render_text(snapshot, { 14, 14 }, {1.0f, 0.5f}, score_text);
 
 	char lives_text[max_text_size];
-	sprintf_s(lives_text, 128, "LIVES: %i", player_state.lives);
-	render_text(renderer, font, { g_screen_area_s.x - (140 * g_scale), 14 }, {1.0, 0.5f}, lives_text);
+	snprintf(lives_text, max_text_size, "LIVES: %i", player_state.lives);
+	render_text(snapshot, { g_screen_area_s.x - (140 * g_scale), 14 }, {1.0, 0.5f}, lives_text);
 }
 
-void Arcanoid::render_final_score(SDL_Renderer* renderer, TTF_Font* font, PlayerState& player_state)
+// Hints stay at the bottom of the window, a larger logical area extends past it
+static constexpr float c_hint_y = g_game_center_s.y + g_game_area_s.y / 2;
+
+void Arcanoid::render_final_score(RenderSnapshot& snapshot, PlayerState& player_state)
 {
 	if (m_registry->size<Block>() == 0)
 	{
-		render_text(renderer, font, g_game_center_s, { 0.5, 0.5f }, "!!!YOU WON!!!");
+		render_text(snapshot, g_game_center_s, { 0.5, 0.5f }, "!!!YOU WON!!!");
 	}
 	else
 	{
-		render_text(renderer, font, g_game_center_s, { 0.5, 0.5f }, "!!!GAME OVER!!!");
+		render_text(snapshot, g_game_center_s, { 0.5, 0.5f }, "!!!GAME OVER!!!");
 	}
 
 	if (is_restart_allowed)
 	{
-		render_text(renderer, font, { g_game_center_s.x, m_game_bounds.max.y }, { 0.5, 0.5f }, "Press Space to restart");
+		render_text(snapshot, { g_game_center_s.x, c_hint_y }, { 0.5, 0.5f }, "Press Space to restart");
 	}
 }
 
-void Arcanoid::render_space_hint(SDL_Renderer* renderer, TTF_Font* font)
+void Arcanoid::render_space_hint(RenderSnapshot& snapshot)
 {
-	render_text(renderer, font, { g_game_center_s.x, m_game_bounds.max.y }, { 0.5, 0.5f }, "Press Space to start");
+	render_text(snapshot, { g_game_center_s.x, c_hint_y }, { 0.5, 0.5f }, "Press Space to start");
+}
+
+void Arcanoid::render_profile_overlay(RenderSnapshot& snapshot)
+{
+	// Smaller than the HUD font, one line per zone
+	constexpr float char_height = 10.0f * g_scale;
+	constexpr float char_width  = 6.0f  * g_scale;
+
+	Profiler::get().get_stats(m_profile_stats);
+
+	Vector2 line_min{ 14, 40 * g_scale };
+	for (const ProfileStat& stat : m_profile_stats)
+	{
+		constexpr size_t max_text_size = 128;
+		char line[max_text_size];
+		const int length = snprintf(line, max_text_size, "%-24s %7.3f ms", stat.name, stat.average_ms);
+		const float width = fmath::min(length, (int)max_text_size - 1) * char_width;
+
+		snapshot.add_text({ line_min, line_min + Vector2{ width, char_height } }, line);
+		line_min.y += char_height;
+	}
 }
\ No newline at end of file
@@ -3,10 +3,26 @@
 #include "Actor.h"
 #include "FMath.h"
 #include "Timer.h"
+#include "ThreadPool.h"
+#include "SystemGraph.h"
+#include "CommandBuffer.h"
+#include "AudioQueue.h"
+#include "AssetArchive.h"
+#include "BlockGrid.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "TextRenderer.h"
+#include "RenderSnapshot.h"
+#include "GameSnapshot.h"
+#include "Level.h"
+#include "Profiler.h"
 
 #include <type_traits>
+#include <random>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
 
 #include <entt/entt.hpp>
 
@@ -19,6 +35,9 @@ struct Mix_Chunk;
 struct _Mix_Music;
 typedef struct _Mix_Music Mix_Music;
 
+// Every random decision of the game comes from one seeded engine, a seed and the inputs replay a run
+using Random = std::mt19937;
+
 // Enums for resources
 enum EBlockColor
 {
@@ -46,6 +65,7 @@ enum EHitSound
 	EHITSOUND_BONUS,
 	EHITSOUND_GROUND,
 	EHITSOUND_FAILURE,
+	EHITSOUND_LASER_ON,
 	EHITSOUND_NUMBER
 };
 
@@ -83,10 +103,16 @@ struct Movable
 	Vector2 velocity;
 };
 
+// Position at the previous fixed step, sprites are drawn blended between it and Transform
+struct PrevTransform
+{
+	Vector2 position;
+};
+
 struct Sprite
 {
-	SDL_Texture* texture{ nullptr };
-	float        alpha{ 1.0f };
+	TextureRegion region;
+	float         alpha{ 1.0f };
 };
 
 struct Pickup
@@ -107,33 +133,95 @@ struct Attach
 	Vector2      offset;
 };
 
+// Payload of CommandBuffer::spawn, balls spawned by one flush are created with bulk inserts
+struct BallSpawn
+{
+	Vector2       position;
+	Vector2       velocity;
+	TextureRegion region;
+
+	static void spawn(entt::registry& registry, const BallSpawn* const* items, size_t count);
+};
+
+// Side effects of a ball step, applied in ball order after all balls have moved
+enum class EBallEvent : uint8_t
+{
+	block_hit,
+	destroy
+};
+
+struct BallEvent
+{
+	EBallEvent   type;
+	entt::entity entity;
+};
+
+// Reused by update_balls, every chunk of balls records into its own buffer
+struct BallScratch
+{
+	std::vector<entt::entity>           balls;
+	std::vector<std::vector<BallEvent>> chunks;
+};
+
 struct Resources
 {
+	// Resources.pak written by larcanoid_pack, when present, assets below point into its mapping
+	AssetArchive archive;
+
 	// Resources
 	TTF_Font*    ttf_font{ nullptr };
-	SDL_Texture* tex_block[EBLOCKCOLOR_NUMBER]{};
-	SDL_Texture* tex_crack[ECRACKCOLOR_NUMBER]{};
 
-	SDL_Texture* tex_ball{};
-	SDL_Texture* tex_platform{};
-	SDL_Texture* tex_laser{};
-	SDL_Texture* tex_pickup{};
+	// Every world sprite is a region of this one texture
+	TextureAtlas  atlas;
+
+	TextureRegion tex_block[EBLOCKCOLOR_NUMBER]{};
+	TextureRegion tex_crack[ECRACKCOLOR_NUMBER]{};
+
+	TextureRegion tex_ball{};
+	TextureRegion tex_platform{};
+	TextureRegion tex_laser{};
+	TextureRegion tex_pickup{};
 
 	Mix_Chunk* mix_hit[EHITSOUND_NUMBER]{};
-	Mix_Chunk* mix_laser_on{};
 
 	Mix_Music* music{};
 
-	void construct(SDL_Renderer* renderer, entt::registry* registry);
+	// Sound and music loads still running on the pool
+	TaskCounter audio_pending{ 0 };
+
+	// Waits for the images, sounds and music keep loading in the background, see is_audio_ready
+	void construct(SDL_Renderer* renderer, entt::registry* registry, ThreadPool& thread_pool);
+	bool is_audio_ready() const;
+
+	// Stable ids of the regions above, snapshots store sprites by id instead of texture pointers
+	uint16_t             get_sprite_id(const TextureRegion& region) const;
+	const TextureRegion& get_sprite(uint16_t id) const;
+
+	// Stops and frees sounds, music and the font before the archive they may point into is unmapped
+	~Resources();
 };
 
 class Arcanoid final : public Actor
 {
 private:
-	std::shared_ptr<Scheduler> m_scheduler;
+	std::shared_ptr<Scheduler>  m_scheduler;
+	std::shared_ptr<ThreadPool> m_thread_pool;
+
+	// Fixed update systems with their declared component access
+	SystemGraph m_systems;
+
+	// Structural changes of the systems, flushed at sync points of on_fixed_update
+	CommandBuffer m_commands;
 
-	static constexpr Rect   m_game_area  { g_game_center_s, g_game_area_s     };
-	static constexpr Bounds m_game_bounds{ fmath::rect_to_bounds(m_game_area) };
+	// Declared before whatever plays or draws from it, so it is released last
+	Resources  res;
+
+	// Sounds requested by the systems, mixed once per frame on its own thread
+	AudioQueue m_audio{ EHITSOUND_NUMBER, g_audio_voice_budget };
+
+	// Logical area, the default one fits the window
+	Rect         m_game_area  { g_game_center_s, g_game_area_s     };
+	Bounds       m_game_bounds{ fmath::rect_to_bounds(m_game_area) };
 
 	EGameState   m_state{ EGameState::game_aim };
 	PlayerState  m_player_state;
@@ -143,7 +231,25 @@ private:
 	entt::entity m_platform{ entt::null };
 	entt::entity m_aim_ball{ entt::null };
 
-	Resources res;
+	// Broadphase over blocks, kept in sync with spawns and update_destroys
+	BlockGrid    m_block_grid{ m_game_bounds, g_block_grid_cell };
+
+	BallScratch  m_ball_scratch;
+
+	// Only touched by whichever thread draws, on_render_snapshot
+	SpriteBatch  m_sprite_batch;
+
+	// HUD text from a glyph atlas of res.ttf_font
+	TextRenderer m_text_renderer;
+
+	// on_render draws through a snapshot as well when there is no render thread
+	RenderSnapshot m_snapshot;
+
+	std::vector<ProfileStat> m_profile_stats;
+
+	bool      m_is_audio_registered{ false };
+
+	Random    m_random;
 
 public:
 	bool is_restart_allowed = false;
@@ -151,49 +257,91 @@ public:
 	bool is_waiting_for_next_level = false;
 	bool is_waiting_for_restart = false;
 
-	static void render_text(SDL_Renderer* renderer, TTF_Font* font, Vector2 offset, Vector2 anchor, const char* text);
-	void render_player_state(SDL_Renderer* renderer, TTF_Font* font, PlayerState& player_state);
-	void render_final_score(SDL_Renderer* renderer, TTF_Font* font, PlayerState& player_state);
-	void render_space_hint(SDL_Renderer* renderer, TTF_Font* font);
+	// Launches balls, follows them with the platform and restarts on game over without any input
+	bool is_autoplay = false;
+
+	// Rolling averages of the profiler zones, empty unless built with LARCANOID_PROFILE
+	bool is_profile_overlay = false;
+
+	static void render_text(RenderSnapshot& snapshot, Vector2 offset, Vector2 anchor, const char* text);
+	void render_player_state(RenderSnapshot& snapshot, PlayerState& player_state);
+	void render_final_score(RenderSnapshot& snapshot, PlayerState& player_state);
+	void render_space_hint(RenderSnapshot& snapshot);
+	void render_profile_overlay(RenderSnapshot& snapshot);
 	
-	void spawn_block_grid(Vector2 offset, uint32_t cols, uint32_t rows, Vector2 block_dims, Vector2 block_offset, float HP);
+	// Unscaled units like level files, blocks outside the game area are skipped and reported
+	void spawn_block_grid(Vector2 offset, uint32_t columns, uint32_t rows, Vector2 block_dims, Vector2 block_offset, float HP);
+	void spawn_level(const Level& level);
+
+	// Unscaled, keeps the top left corner of the default area and clears the game
+	void set_game_area(Vector2 dimensions);
+
+	// Blocks with one life over the upper half and balls flying up from below them
+	void spawn_stress_scene(uint32_t blocks, uint32_t balls);
+
+	// Name relative to Resources/, from Resources.pak when the game runs from it
+	bool load_level(std::string_view name, Level& level) const;
 
 	void spawn_random_pickup();
 	void reset_to_start(bool full);
 	void check_win_conditions();
+	void update_autoplay();
+	void register_systems();
+	void register_audio();
 
 	bool progress_to_next_level();
 	void reset_player_state();
 
+	// Registry, game state and player state in one buffer.
+	// Timers aren't saved: the pickup timer restarts and timed power-ups end on load
+	void save_state(GameSnapshot& snapshot) const;
+	bool load_state(const GameSnapshot& snapshot, bool with_player_state);
+
 	virtual void on_construct(SDL_Renderer* renderer, entt::registry* registry) override;
 	virtual void on_update(float delta_time) override;
 	virtual void on_fixed_update() override;
-	virtual void on_render(SDL_Renderer* renderer) override;
+	virtual void on_render(SDL_Renderer* renderer, float blend) override;
+	virtual void on_snapshot(RenderSnapshot& snapshot, float blend) override;
+	virtual void on_render_snapshot(SDL_Renderer* renderer, const RenderSnapshot& snapshot) override;
 	virtual void on_input(EInputEvent e, bool changed) override;
+	virtual bool is_idle() const override;
+
+	// Groups and pools every system expects, before the first entity is created
+	static void prepare_registry(entt::registry* registry);
 
 	static Vector2 get_entity_position(entt::registry* registry, entt::entity entity);
 	static bool    set_entity_position(entt::registry* registry, entt::entity entity, Vector2 position);
 
+	// Moves without interpolating from the old position
+	static bool    teleport_entity(entt::registry* registry, entt::entity entity, Vector2 position);
+
 	// Those functions could be moved into separate files, if you want to refactor it that way
-	static entt::entity spawn_platform(entt::registry* registry, SDL_Texture* platform_texture);
-	static entt::entity spawn_pickup(entt::registry* registry, SDL_Texture* pickup_texture);
-	static entt::entity spawn_ball(entt::registry* registry, const Vector2& position, const Vector2 velocity, SDL_Texture* platform_texture);
-	static entt::entity spawn_laser(entt::registry* registry, entt::entity platform_entity, SDL_Texture* laser_texture);
+	static entt::entity spawn_platform(entt::registry* registry, const Bounds& game_bounds, const TextureRegion& platform_texture);
+	static entt::entity spawn_pickup(entt::registry* registry, const Bounds& game_bounds, const TextureRegion& pickup_texture, Random& random);
+	static entt::entity spawn_ball(entt::registry* registry, const Vector2& position, const Vector2 velocity, const TextureRegion& platform_texture);
+	static entt::entity spawn_laser(entt::registry* registry, const Bounds& game_bounds, entt::entity platform_entity, const TextureRegion& laser_texture);
+
+	// Bulk creates the blocks inside the game area, returns how many
+	static size_t spawn_level(entt::registry* registry, const Bounds& game_bounds, BlockGrid& block_grid, const Level& level, const Resources& res, Random& random);
 
 	static void remove_balls(entt::registry* registry);
 	static void remove_pickups(entt::registry* registry);
 
-	static void update_balls(entt::registry* registry, entt::entity platform_entity, Resources& res);
-	static void update_lifes(entt::registry* registry, PlayerState& player_state);
-	static void update_pickups(entt::registry* registry, std::shared_ptr<Scheduler> scheduler, entt::entity platform_entity, Resources& res);
-	static void update_destroys(entt::registry* registry);
+	static void update_balls(entt::registry* registry, const Bounds& game_bounds, entt::entity platform_entity, const BlockGrid& block_grid, Resources& res, ThreadPool* thread_pool, BallScratch& scratch, CommandBuffer& commands, AudioQueue& audio, Random& random);
+	static void update_lifes(entt::registry* registry, PlayerState& player_state, CommandBuffer& commands);
+	static void update_pickups(entt::registry* registry, const Bounds& game_bounds, std::shared_ptr<Scheduler> scheduler, entt::entity platform_entity, Resources& res, CommandBuffer& commands, AudioQueue& audio);
+	static void update_destroys(entt::registry* registry, BlockGrid& block_grid, CommandBuffer& commands);
 	static void update_movable(entt::registry* registry);
-	static void update_laser(entt::registry* registry);
-	static void update_attach(entt::registry* registry);
+	static void update_laser(entt::registry* registry, const BlockGrid& block_grid);
+	static void update_attach(entt::registry* registry, CommandBuffer& commands);
+	static void update_prev_transforms(entt::registry* registry);
+
+	static void render_sprites(entt::registry* registry, RenderSnapshot& snapshot, float blend);
 
-	static void render_sprites(entt::registry* registry, SDL_Renderer* renderer);
+	const PlayerState& get_player_state() const;
+	const entt::registry& get_registry() const;
 
-	Arcanoid(std::shared_ptr<Scheduler> scheduler);
+	Arcanoid(std::shared_ptr<Scheduler> scheduler, std::shared_ptr<ThreadPool> thread_pool, uint64_t seed);
 	virtual ~Arcanoid();
 	Arcanoid(Arcanoid&) = delete;
 };
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "AssetArchive.h"
+
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool AssetArchive::validate()
+{
+	if (m_size < sizeof(AssetArchiveHeader))
+	{
+		return false;
+	}
+
+	const AssetArchiveHeader* header = reinterpret_cast<const AssetArchiveHeader*>(m_data);
+	if (memcmp(header->magic, g_asset_archive_magic, sizeof(header->magic)) != 0 || header->version != g_asset_archive_version)
+	{
+		return false;
+	}
+
+	if (sizeof(AssetArchiveHeader) + (uint64_t)header->entry_count * sizeof(AssetEntry) > m_size)
+	{
+		return false;
+	}
+
+	m_entries     = reinterpret_cast<const AssetEntry*>(m_data + sizeof(AssetArchiveHeader));
+	m_entry_count = header->entry_count;
+
+	for (uint32_t i = 0; i < m_entry_count; ++i)
+	{
+		if (memchr(m_entries[i].name, 0, sizeof(m_entries[i].name)) == nullptr)
+		{
+			return false;
+		}
+
+		const AssetEntry& entry = m_entries[i];
+		if (entry.offset > m_size || entry.size > m_size - entry.offset)
+		{
+			return false;
+		}
+
+		// find() is a binary search, names have to be strictly ascending
+		if (i > 0 && !(std::string_view{ m_entries[i - 1].name } < std::string_view{ entry.name }))
+		{
+			return false;
+		}
+
+		// Surfaces are created straight over the entry, every row has to be inside it
+		if (entry.type == EAssetType::image)
+		{
+			const uint64_t width  = entry.params[0];
+			const uint64_t height = entry.params[1];
+			const uint64_t pitch  = entry.params[2];
+			if (width > INT_MAX || height > INT_MAX || pitch > INT_MAX || pitch < width * 4 || pitch * height > entry.size)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool AssetArchive::open(const char* path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	GetFileSizeEx(file, &size);
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file    = file;
+	m_mapping = mapping;
+	m_data    = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size    = (size_t)size.QuadPart;
+#else
+	const int file = ::open(path, O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info{};
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	// Mapping stays valid after the descriptor is closed
+	void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = (size_t)info.st_size;
+#endif
+
+	if (m_data == nullptr || !validate())
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void AssetArchive::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file)
+	{
+		CloseHandle(m_file);
+	}
+	m_file    = nullptr;
+	m_mapping = nullptr;
+#else
+	if (m_data)
+	{
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+#endif
+
+	m_data        = nullptr;
+	m_size        = 0;
+	m_entries     = nullptr;
+	m_entry_count = 0;
+}
+
+bool AssetArchive::is_open() const
+{
+	return m_data != nullptr;
+}
+
+const AssetEntry* AssetArchive::find(std::string_view name) const
+{
+	// Packer sorts entries by name
+	const AssetEntry* last  = m_entries + m_entry_count;
+	const AssetEntry* entry = std::lower_bound(m_entries, last, name, [](const AssetEntry& entry, std::string_view name)
+	{
+		return std::string_view{ entry.name } < name;
+	});
+
+	if (entry == last || std::string_view{ entry->name } != name)
+	{
+		return nullptr;
+	}
+
+	return entry;
+}
+
+const void* AssetArchive::get_data(const AssetEntry& entry) const
+{
+	return m_data + entry.offset;
+}
+
+SDL_Surface* AssetArchive::create_surface(std::string_view name) const
+{
+	const AssetEntry* entry = find(name);
+	if (entry == nullptr || entry->type != EAssetType::image)
+	{
+		return nullptr;
+	}
+
+	// Pixels are only read, blits and texture uploads never write the source
+	void* pixels = const_cast<void*>(get_data(*entry));
+	return SDL_CreateRGBSurfaceWithFormatFrom(pixels, (int)entry->params[0], (int)entry->params[1], 32, (int)entry->params[2], SDL_PIXELFORMAT_RGBA32);
+}
+
+Mix_Chunk* AssetArchive::create_chunk(std::string_view name) const
+{
+	const AssetEntry* entry = find(name);
+	if (entry == nullptr || entry->type != EAssetType::sound)
+	{
+		return nullptr;
+	}
+
+	int frequency = 0;
+	Uint16 format = 0;
+	int channels  = 0;
+	if (Mix_QuerySpec(&frequency, &format, &channels) == 0)
+	{
+		return nullptr;
+	}
+
+	Uint8* samples = static_cast<Uint8*>(const_cast<void*>(get_data(*entry)));
+
+	// Mixer only reads the samples, chunk doesn't own them
+	if ((int)entry->params[0] == frequency && entry->params[1] == format && (int)entry->params[2] == channels)
+	{
+		return Mix_QuickLoad_RAW(samples, (Uint32)entry->size);
+	}
+
+	// Device opened with another format than the packer assumed, convert a copy
+	SDL_AudioCVT cvt{};
+	if (SDL_BuildAudioCVT(&cvt, (SDL_AudioFormat)entry->params[1], (Uint8)entry->params[2], (int)entry->params[0], format, (Uint8)channels, frequency) < 0)
+	{
+		return nullptr;
+	}
+
+	cvt.len = (int)entry->size;
+	cvt.buf = static_cast<Uint8*>(SDL_malloc((size_t)cvt.len * cvt.len_mult));
+	memcpy(cvt.buf, samples, entry->size);
+	SDL_ConvertAudio(&cvt);
+
+	Mix_Chunk* chunk = Mix_QuickLoad_RAW(cvt.buf, (Uint32)cvt.len_cvt);
+	if (chunk)
+	{
+		// Mix_FreeChunk releases the converted copy
+		chunk->allocated = 1;
+	}
+	return chunk;
+}
+
+SDL_RWops* AssetArchive::open_blob(std::string_view name) const
+{
+	const AssetEntry* entry = find(name);
+	if (entry == nullptr)
+	{
+		return nullptr;
+	}
+
+	return SDL_RWFromConstMem(get_data(*entry), (int)entry->size);
+}
+
+AssetArchive::AssetArchive()
+{
+}
+
+AssetArchive::~AssetArchive()
+{
+	close();
+}
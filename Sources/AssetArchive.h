@@ -0,0 +1,82 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+struct SDL_Surface;
+struct SDL_RWops;
+struct Mix_Chunk;
+
+// Resources/ packed by larcanoid_pack into one file:
+// header, entries sorted by name, then the data of every entry at 16 byte alignment.
+// Images are RGBA32 pixels, sounds are PCM in the device format, everything else is the file as is.
+enum class EAssetType : uint32_t
+{
+	image = 0,
+	sound,
+	blob
+};
+
+constexpr char     g_asset_archive_magic[8]{ 'L', 'A', 'R', 'C', 'P', 'A', 'K', 0 };
+constexpr uint32_t g_asset_archive_version{ 1 };
+constexpr size_t   g_asset_data_alignment{ 16 };
+
+struct AssetArchiveHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t entry_count;
+};
+
+struct AssetEntry
+{
+	// Path relative to Resources/, with forward slashes
+	char       name[48];
+	EAssetType type;
+
+	// image: width, height, pitch
+	// sound: frequency, SDL_AudioFormat, channels
+	uint32_t   params[3];
+
+	uint64_t   offset;
+	uint64_t   size;
+};
+
+// Read-only memory mapping of an archive, assets are created straight from the mapped bytes.
+// Everything created from it references the mapping, so the archive has to outlive them.
+class AssetArchive final
+{
+private:
+	const uint8_t*    m_data{ nullptr };
+	size_t            m_size{ 0 };
+	const AssetEntry* m_entries{ nullptr };
+	uint32_t          m_entry_count{ 0 };
+
+#ifdef _WIN32
+	void* m_file{ nullptr };
+	void* m_mapping{ nullptr };
+#endif
+
+	bool validate();
+
+public:
+	bool open(const char* path);
+	void close();
+	bool is_open() const;
+
+	const AssetEntry* find(std::string_view name) const;
+	const void*       get_data(const AssetEntry& entry) const;
+
+	// Surface over the mapped pixels, free it with SDL_FreeSurface
+	SDL_Surface* create_surface(std::string_view name) const;
+
+	// Chunk over the mapped samples, converted into a copy if the device format differs
+	Mix_Chunk*   create_chunk(std::string_view name) const;
+
+	// Read-only stream over the mapped bytes
+	SDL_RWops*   open_blob(std::string_view name) const;
+
+	AssetArchive();
+	~AssetArchive();
+	AssetArchive(AssetArchive&) = delete;
+};
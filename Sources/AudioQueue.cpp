@@ -0,0 +1,156 @@
+#include "AudioQueue.h"
+
+#include <SDL_mixer.h>
+#include <algorithm>
+
+bool AudioQueue::pop(uint8_t& sound)
+{
+	// Single consumer, so no CAS on this side
+	const size_t position = m_dequeue.load(std::memory_order_relaxed);
+	Cell& cell = m_cells[position & (c_capacity - 1)];
+	if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+	{
+		return false;
+	}
+
+	sound = cell.sound;
+	m_dequeue.store(position + 1, std::memory_order_relaxed);
+	cell.sequence.store(position + c_capacity, std::memory_order_release);
+	return true;
+}
+
+void AudioQueue::mix_frame()
+{
+	uint8_t sound;
+	while (pop(sound))
+	{
+		if (sound < m_requests.size())
+		{
+			++m_requests[sound];
+		}
+	}
+
+	m_order.clear();
+	for (size_t i = 0; i < m_requests.size(); ++i)
+	{
+		if (m_requests[i] > 0 && m_mix_sounds[i].chunk)
+		{
+			m_order.push_back((uint8_t)i);
+		}
+		m_requests[i] = 0;
+	}
+
+	if (m_order.empty())
+	{
+		return;
+	}
+
+	std::stable_sort(m_order.begin(), m_order.end(), [this](uint8_t first, uint8_t second)
+	{
+		return m_mix_sounds[first].priority > m_mix_sounds[second].priority;
+	});
+
+	// Never more than the budget, and never steal channels that are still playing
+	const int free_channels = Mix_AllocateChannels(-1) - Mix_Playing(-1);
+	const size_t voices = std::min<size_t>({ m_order.size(), m_voice_budget, (size_t)std::max(free_channels, 0) });
+	for (size_t i = 0; i < voices; ++i)
+	{
+		Mix_PlayChannel(-1, m_mix_sounds[m_order[i]].chunk, 0);
+	}
+}
+
+void AudioQueue::consumer_main()
+{
+	uint64_t frames_mixed = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			m_wake.wait(lock, [&]() { return m_stop || m_frames != frames_mixed; });
+			if (m_stop)
+			{
+				return;
+			}
+
+			// Late frames are mixed together, a busy mixer shouldn't build up a backlog
+			frames_mixed = m_frames;
+			m_mix_sounds = m_sounds;
+		}
+
+		// Unlocked, so end_frame never waits on the mixer
+		mix_frame();
+	}
+}
+
+void AudioQueue::set_sound(uint8_t sound, Mix_Chunk* chunk, uint8_t priority)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_sounds[sound] = { chunk, priority };
+}
+
+bool AudioQueue::push(uint8_t sound)
+{
+	size_t position = m_enqueue.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Cell& cell = m_cells[position & (c_capacity - 1)];
+		const intptr_t difference = (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)position;
+		if (difference == 0)
+		{
+			if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				cell.sound = sound;
+				cell.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			++m_dropped;
+			return false;
+		}
+		else
+		{
+			position = m_enqueue.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void AudioQueue::end_frame()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		++m_frames;
+	}
+	m_wake.notify_one();
+}
+
+uint64_t AudioQueue::get_dropped_count() const
+{
+	return m_dropped;
+}
+
+AudioQueue::AudioQueue(size_t sound_count, uint32_t voice_budget) :
+	m_cells(std::make_unique<Cell[]>(c_capacity)), 
+	m_sounds(sound_count), 
+	m_voice_budget(voice_budget), 
+	m_requests(sound_count)
+{
+	for (size_t i = 0; i < c_capacity; ++i)
+	{
+		m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	m_order.reserve(sound_count);
+	m_thread = std::thread(&AudioQueue::consumer_main, this);
+}
+
+AudioQueue::~AudioQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stop = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Mix_Chunk;
+
+// Sound requests from any thread, played by a thread of its own.
+// Requests between two end_frame() calls make one frame: duplicates collapse into one voice
+// and at most voice_budget voices start, highest priority first.
+class AudioQueue final
+{
+private:
+	// Bounded lock-free ring, producers claim cells with a CAS, the consumer thread frees them
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		uint8_t             sound;
+	};
+
+	struct Sound
+	{
+		Mix_Chunk* chunk{ nullptr };
+		uint8_t    priority{ 0 };
+	};
+
+	static constexpr size_t c_capacity = 1024;
+	static_assert((c_capacity & (c_capacity - 1)) == 0, "Ring capacity has to be a power of two");
+
+	std::unique_ptr<Cell[]> m_cells;
+	alignas(64) std::atomic<size_t> m_enqueue{ 0 };
+	alignas(64) std::atomic<size_t> m_dequeue{ 0 };
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	std::vector<Sound>    m_sounds;
+	uint32_t              m_voice_budget;
+
+	// Consumer side only, m_mix_sounds is copied from m_sounds under the lock before every mix
+	std::vector<Sound>    m_mix_sounds;
+	std::vector<uint32_t> m_requests;
+	std::vector<uint8_t>  m_order;
+
+	std::thread             m_thread;
+	std::mutex              m_mutex;
+	std::condition_variable m_wake;
+	uint64_t                m_frames{ 0 };
+	bool                    m_stop{ false };
+
+	bool pop(uint8_t& sound);
+	void mix_frame();
+	void consumer_main();
+
+public:
+	void set_sound(uint8_t sound, Mix_Chunk* chunk, uint8_t priority);
+
+	// Lock-free, returns false and drops the request when the ring is full
+	bool push(uint8_t sound);
+	void end_frame();
+
+	// Requests lost to a full ring, not the ones cut by the voice budget
+	uint64_t get_dropped_count() const;
+
+	AudioQueue(size_t sound_count, uint32_t voice_budget);
+	~AudioQueue();
+	AudioQueue(AudioQueue&) = delete;
+};
@@ -0,0 +1,561 @@
+#include "Arcanoid.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Same area the game simulates in
+static constexpr Bounds c_game_bounds{ fmath::rect_to_bounds({ g_game_center_s, g_game_area_s }) };
+
+// Inputs of the fmath benchmarks are cycled through, large enough to defeat branch prediction
+static constexpr size_t c_input_count = 4096;
+
+struct BenchOptions
+{
+	const char* filter{ nullptr };
+	const char* json_path{ nullptr };
+	const char* baseline_path{ nullptr };
+
+	// Slower than the baseline by more than this fraction counts as a regression
+	double threshold{ 0.1 };
+
+	// Every benchmark repeats until it ran at least this long
+	double min_time{ 0.25 };
+};
+
+struct BenchResult
+{
+	std::string name;
+	uint64_t    iterations;
+	uint64_t    items;
+	double      ns_per_op;
+};
+
+// Results escape through here, so the measured code can't be optimized away
+static volatile float g_sink;
+
+class BenchSuite final
+{
+private:
+	BenchOptions             m_options;
+	std::vector<BenchResult> m_results;
+
+public:
+	bool is_enabled(const char* name) const
+	{
+		return m_options.filter == nullptr || strstr(name, m_options.filter) != nullptr;
+	}
+
+	// Times fun in doubling batches until min_time is reached, items is the work done by one call
+	template<class fn>
+	void run(const char* name, uint64_t items, fn&& fun)
+	{
+		if (!is_enabled(name))
+		{
+			return;
+		}
+
+		fun();
+
+		uint64_t iterations = 0;
+		uint64_t batch      = 1;
+		double   elapsed_ns = 0.0;
+		while (elapsed_ns < m_options.min_time * 1e9)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < batch; ++i)
+			{
+				fun();
+			}
+			const auto end = std::chrono::steady_clock::now();
+
+			elapsed_ns += std::chrono::duration<double, std::nano>(end - start).count();
+			iterations += batch;
+			batch *= 2;
+		}
+
+		const BenchResult result{ name, iterations, items, elapsed_ns / iterations };
+		printf("%-48s %14.1f ns/op %10.2f ns/item %10llu runs\n",
+			result.name.c_str(), result.ns_per_op, result.ns_per_op / result.items, (unsigned long long)result.iterations);
+		fflush(stdout);
+
+		m_results.push_back(result);
+	}
+
+	// One benchmark per line, read back by compare_baseline
+	bool write_json(const char* path) const
+	{
+		FILE* file = fopen(path, "w");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		fprintf(file, "{\"benchmarks\":[\n");
+		for (size_t i = 0; i < m_results.size(); ++i)
+		{
+			const BenchResult& result = m_results[i];
+			fprintf(file, "{\"name\":\"%s\",\"iterations\":%llu,\"items\":%llu,\"ns_per_op\":%.3f,\"ns_per_item\":%.3f}%s\n",
+				result.name.c_str(), (unsigned long long)result.iterations, (unsigned long long)result.items,
+				result.ns_per_op, result.ns_per_op / result.items, i + 1 < m_results.size() ? "," : "");
+		}
+		fprintf(file, "]}\n");
+
+		return fclose(file) == 0;
+	}
+
+	// Returns the number of regressions, or -1 when the baseline can't be read
+	int compare_baseline(const char* path) const
+	{
+		FILE* file = fopen(path, "r");
+		if (file == nullptr)
+		{
+			return -1;
+		}
+
+		std::vector<BenchResult> baseline;
+		char line[512];
+		while (fgets(line, sizeof(line), file))
+		{
+			const char* name = strstr(line, "\"name\":\"");
+			const char* ns   = strstr(line, "\"ns_per_op\":");
+			if (name == nullptr || ns == nullptr)
+			{
+				continue;
+			}
+
+			name += strlen("\"name\":\"");
+			const char* name_end = strchr(name, '"');
+			if (name_end == nullptr)
+			{
+				continue;
+			}
+			baseline.push_back({ std::string(name, name_end), 0, 0, strtod(ns + strlen("\"ns_per_op\":"), nullptr) });
+		}
+		fclose(file);
+
+		printf("\nCompared to %s, regression threshold %.0f%%\n", path, m_options.threshold * 100.0);
+
+		int regressions = 0;
+		for (const BenchResult& result : m_results)
+		{
+			const BenchResult* base = nullptr;
+			for (const BenchResult& candidate : baseline)
+			{
+				if (candidate.name == result.name)
+				{
+					base = &candidate;
+					break;
+				}
+			}
+
+			if (base == nullptr || base->ns_per_op <= 0.0)
+			{
+				printf("%-48s %14s\n", result.name.c_str(), "new");
+				continue;
+			}
+
+			const double change = result.ns_per_op / base->ns_per_op - 1.0;
+			const bool   regressed = change > m_options.threshold;
+			printf("%-48s %+13.1f%% %s\n", result.name.c_str(), change * 100.0, regressed ? "REGRESSION" : "");
+			regressions += regressed ? 1 : 0;
+		}
+		return regressions;
+	}
+
+	BenchSuite(const BenchOptions& options) : m_options(options)
+	{
+	}
+};
+
+static void bench_fmath(BenchSuite& suite)
+{
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<float> coord(c_game_bounds.min.x, c_game_bounds.max.x);
+	std::uniform_real_distribution<float> extent(2.0f, 40.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Circle>  circles(c_input_count);
+	std::vector<Bounds>  bounds(c_input_count);
+	std::vector<Vector2> vectors(c_input_count);
+	std::vector<float>   scalars(c_input_count);
+	for (size_t i = 0; i < c_input_count; ++i)
+	{
+		circles[i] = { { coord(gen), coord(gen) }, g_ball_radius };
+
+		const Vector2 min{ coord(gen), coord(gen) };
+		bounds[i]  = { min, min + Vector2{ extent(gen), extent(gen) } };
+		vectors[i] = Vector2{ unit(gen), unit(gen) } * g_ball_start_velocity;
+		scalars[i] = unit(gen);
+	}
+
+	suite.run("fmath/has_intersection", c_input_count, [&]()
+	{
+		uint32_t hits = 0;
+		for (size_t i = 0; i < c_input_count; ++i)
+		{
+			hits += fmath::has_intersection(circles[i], bounds[(i * 7) % c_input_count]) ? 1 : 0;
+		}
+		g_sink = (float)hits;
+	});
+
+	suite.run("fmath/rotated", c_input_count, [&]()
+	{
+		Vector2 sum{};
+		for (size_t i = 0; i < c_input_count; ++i)
+		{
+			sum = sum + fmath::rotated(vectors[i], scalars[i]);
+		}
+		g_sink = sum.x + sum.y;
+	});
+
+	suite.run("fmath/proj_to_hemi", c_input_count, [&]()
+	{
+		Vector2 sum{};
+		for (size_t i = 0; i < c_input_count; ++i)
+		{
+			sum = sum + fmath::proj_to_hemi(50.0f * fmath::conv_to_rad, scalars[i] * 40.0f, g_platform_dimensions.x);
+		}
+		g_sink = sum.x + sum.y;
+	});
+
+	suite.run("fmath/sweep", c_input_count, [&]()
+	{
+		float sum = 0.0f;
+		for (size_t i = 0; i < c_input_count; ++i)
+		{
+			float   toi = 1.0f;
+			Vector2 normal{};
+			if (fmath::sweep(circles[i], vectors[i] * (float)g_fixed_delta_time, bounds[(i * 7) % c_input_count], toi, normal))
+			{
+				sum += toi;
+			}
+		}
+		g_sink = sum;
+	});
+}
+
+// Blocks fill the upper half of the area in a square-ish grid
+static void spawn_blocks(entt::registry& registry, BlockGrid& block_grid, uint32_t count)
+{
+	const uint32_t cols = (uint32_t)ceilf(sqrtf((float)count * 2.0f));
+	const uint32_t rows = (count + cols - 1) / cols;
+	const Vector2  area{ c_game_bounds.max.x - c_game_bounds.min.x, (c_game_bounds.max.y - c_game_bounds.min.y) / 2 };
+	const Vector2  cell{ area.x / cols, area.y / rows };
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Vector2 position{ c_game_bounds.min + cell * Vector2{ (float)(i % cols) + 0.5f, (float)(i / cols) + 0.5f } };
+		const entt::entity entity = registry.create();
+		const Transform& transform = registry.emplace<Transform>(entity, position, cell * 0.8f);
+		registry.emplace<Block>(entity);
+		registry.emplace<Sprite>(entity);
+		registry.emplace<Life>(entity, 1e9f);
+		registry.emplace<Collider>(entity);
+		block_grid.insert(entity, fmath::transform_to_rect(transform));
+	}
+}
+
+static void bench_update_balls(BenchSuite& suite, ThreadPool& thread_pool, uint32_t balls, uint32_t blocks)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "update_balls/balls:%u/blocks:%u", balls, blocks);
+	if (!suite.is_enabled(name))
+	{
+		return;
+	}
+
+	entt::registry registry;
+	Arcanoid::prepare_registry(&registry);
+
+	BlockGrid block_grid{ c_game_bounds, g_block_grid_cell };
+	spawn_blocks(registry, block_grid, blocks);
+
+	// Blocks never die and the platform covers the whole ground, so the scene never runs out of balls
+	const entt::entity platform = registry.create();
+	registry.emplace<Platform>(platform);
+	registry.emplace<Transform>(platform, Vector2{ (c_game_bounds.min.x + c_game_bounds.max.x) / 2, c_game_bounds.max.y - g_platform_elevation },
+		Vector2{ c_game_bounds.max.x - c_game_bounds.min.x, g_platform_dimensions.y });
+	registry.emplace<Collider>(platform);
+
+	std::mt19937 gen(2);
+	std::uniform_real_distribution<float> x(c_game_bounds.min.x + g_ball_radius, c_game_bounds.max.x - g_ball_radius);
+	std::uniform_real_distribution<float> y((c_game_bounds.min.y + c_game_bounds.max.y) / 2, c_game_bounds.max.y - g_platform_elevation * 3);
+	std::uniform_real_distribution<float> angle(-1.2f, 1.2f);
+	for (uint32_t i = 0; i < balls; ++i)
+	{
+		Arcanoid::spawn_ball(&registry, { x(gen), y(gen) }, fmath::rotated({ 0, -g_ball_start_velocity }, angle(gen)), {});
+	}
+
+	Resources     res;
+	BallScratch   scratch;
+	CommandBuffer commands{ &thread_pool };
+	AudioQueue    audio{ EHITSOUND_NUMBER, g_audio_voice_budget };
+	Random        random{ 4 };
+
+	suite.run(name, balls, [&]()
+	{
+		Arcanoid::update_balls(&registry, c_game_bounds, platform, block_grid, res, &thread_pool, scratch, commands, audio, random);
+		commands.clear();
+
+		// Drained every frame like in the game, a full ring would time the drop path instead
+		audio.end_frame();
+	});
+}
+
+static void bench_update_laser(BenchSuite& suite, uint32_t blocks)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "update_laser/blocks:%u", blocks);
+	if (!suite.is_enabled(name))
+	{
+		return;
+	}
+
+	entt::registry registry;
+	Arcanoid::prepare_registry(&registry);
+
+	BlockGrid block_grid{ c_game_bounds, g_block_grid_cell };
+	spawn_blocks(registry, block_grid, blocks);
+
+	const entt::entity platform = registry.create();
+	registry.emplace<Transform>(platform, Vector2{ (c_game_bounds.min.x + c_game_bounds.max.x) / 2, c_game_bounds.max.y }, g_platform_dimensions);
+
+	const entt::entity laser = registry.create();
+	registry.emplace<Transform>(laser, Vector2{ (c_game_bounds.min.x + c_game_bounds.max.x) / 2, (c_game_bounds.min.y + c_game_bounds.max.y) / 2 },
+		Vector2{ 15 * g_scale, c_game_bounds.max.y - c_game_bounds.min.y });
+	registry.emplace<Laser>(laser);
+	registry.emplace<Attach>(laser, platform, Vector2{ 0.0f, -(c_game_bounds.max.y - c_game_bounds.min.y) / 2 });
+
+	suite.run(name, blocks, [&]()
+	{
+		Arcanoid::update_laser(&registry, block_grid);
+	});
+}
+
+// Square-ish grid over the whole area, read from the compiled form and spawned into an empty registry
+static void bench_spawn_level(BenchSuite& suite, uint32_t blocks)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "spawn_level/blocks:%u", blocks);
+	if (!suite.is_enabled(name))
+	{
+		return;
+	}
+
+	const uint32_t cols = (uint32_t)ceilf(sqrtf((float)blocks));
+	const Vector2  cell{ g_game_area / (float)cols };
+
+	Level level;
+	for (uint32_t i = 0; i < blocks; ++i)
+	{
+		const Vector2 position{ cell * Vector2{ (float)(i % cols) + 0.5f, (float)(i / cols) + 0.5f } };
+		level.blocks.push_back({ position, cell * 0.8f, 1.0f, g_level_random_color });
+	}
+
+	std::vector<uint8_t> data;
+	level.write_binary(data);
+
+	entt::registry registry;
+	Arcanoid::prepare_registry(&registry);
+
+	BlockGrid block_grid{ c_game_bounds, g_block_grid_cell };
+	Resources res;
+	Random    random{ 4 };
+
+	suite.run(name, blocks, [&]()
+	{
+		registry.clear();
+		block_grid.clear();
+		level.read_binary(data.data(), data.size());
+		Arcanoid::spawn_level(&registry, c_game_bounds, block_grid, level, res, random);
+	});
+}
+
+// Before Transform, position was either a Rect or a Circle component, found through try_get
+static void update_movable_dispatch(entt::registry* registry)
+{
+	auto circle_view = registry->view<Movable>();
+	for (auto [entity, mov] : circle_view.each())
+	{
+		if (Rect* rect = registry->try_get<Rect>(entity))
+		{
+			rect->position = rect->position + mov.velocity * (float)g_fixed_delta_time;
+		}
+		else if (Circle* circle = registry->try_get<Circle>(entity))
+		{
+			circle->position = circle->position + mov.velocity * (float)g_fixed_delta_time;
+		}
+	}
+}
+
+static void bench_update_movable(BenchSuite& suite, uint32_t entities)
+{
+	char name[128];
+
+	// Half rects, half circles, interleaved the way pickups and balls are spawned
+	snprintf(name, sizeof(name), "update_movable/try_get/entities:%u", entities);
+	if (suite.is_enabled(name))
+	{
+		entt::registry before;
+		for (uint32_t i = 0; i < entities; ++i)
+		{
+			const entt::entity entity = before.create();
+			const Vector2 position{ (float)(i % 100), (float)(i / 100) };
+			if (i % 2 == 0)
+			{
+				before.emplace<Rect>(entity, position, Vector2{ 20, 20 });
+			}
+			else
+			{
+				before.emplace<Circle>(entity, position, g_ball_radius);
+			}
+			before.emplace<Sprite>(entity);
+			before.emplace<Movable>(entity, Vector2{ 0, 320 });
+		}
+
+		suite.run(name, entities, [&]() { update_movable_dispatch(&before); });
+	}
+
+	snprintf(name, sizeof(name), "update_movable/group/entities:%u", entities);
+	if (suite.is_enabled(name))
+	{
+		entt::registry after;
+		Arcanoid::prepare_registry(&after);
+		for (uint32_t i = 0; i < entities; ++i)
+		{
+			const entt::entity entity = after.create();
+			const Vector2 position{ (float)(i % 100), (float)(i / 100) };
+			if (i % 2 == 0)
+			{
+				after.emplace<Transform>(entity, position, Vector2{ 20, 20 });
+			}
+			else
+			{
+				after.emplace<Transform>(entity, fmath::circle_to_transform({ position, g_ball_radius }));
+			}
+			after.emplace<Sprite>(entity);
+			after.emplace<Movable>(entity, Vector2{ 0, 320 });
+		}
+
+		suite.run(name, entities, [&]() { Arcanoid::update_movable(&after); });
+	}
+}
+
+static void bench_scheduler(BenchSuite& suite, uint32_t timers)
+{
+	char name[128];
+	snprintf(name, sizeof(name), "Scheduler/schedule_fire/timers:%u", timers);
+	if (!suite.is_enabled(name))
+	{
+		return;
+	}
+
+	std::mt19937 gen(3);
+	std::uniform_real_distribution<float> delay(0.0f, 1.0f);
+	std::vector<float> delays(timers);
+	for (float& when : delays)
+	{
+		when = delay(gen);
+	}
+
+	Scheduler scheduler(false);
+	scheduler.reserve(timers);
+
+	uint32_t fired = 0;
+	suite.run(name, timers, [&]()
+	{
+		for (const float when : delays)
+		{
+			scheduler.schedule(when, [&fired]() { ++fired; });
+		}
+		scheduler.advance(1.0f);
+		scheduler.reset();
+	});
+	g_sink = (float)fired;
+}
+
+// Usage: larcanoid_bench [--filter TEXT] [--json FILE] [--baseline FILE] [--threshold PERCENT] [--min-time SECONDS]
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			options.filter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			options.json_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			options.baseline_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+		{
+			options.threshold = strtod(argv[++i], nullptr) / 100.0;
+		}
+		else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+		{
+			options.min_time = strtod(argv[++i], nullptr);
+		}
+	}
+
+	BenchSuite suite{ options };
+	ThreadPool thread_pool;
+
+	bench_fmath(suite);
+
+	for (const uint32_t balls : { 16u, 256u, 4096u })
+	{
+		for (const uint32_t blocks : { 64u, 1024u, 16384u })
+		{
+			bench_update_balls(suite, thread_pool, balls, blocks);
+		}
+	}
+
+	for (const uint32_t blocks : { 64u, 1024u, 16384u })
+	{
+		bench_update_laser(suite, blocks);
+	}
+
+	for (const uint32_t blocks : { 1024u, 16384u, 100000u })
+	{
+		bench_spawn_level(suite, blocks);
+	}
+
+	for (const uint32_t entities : { 1000u, 10000u, 100000u })
+	{
+		bench_update_movable(suite, entities);
+	}
+
+	for (const uint32_t timers : { 64u, 1024u, 16384u })
+	{
+		bench_scheduler(suite, timers);
+	}
+
+	if (options.json_path && !suite.write_json(options.json_path))
+	{
+		printf("Failed to write %s\n", options.json_path);
+		return 1;
+	}
+
+	if (options.baseline_path)
+	{
+		const int regressions = suite.compare_baseline(options.baseline_path);
+		if (regressions < 0)
+		{
+			printf("Failed to read %s\n", options.baseline_path);
+			return 1;
+		}
+		return regressions > 0 ? 1 : 0;
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include "BlockGrid.h"
+#include "Arcanoid.h"
+
+#include <algorithm>
+#include <float.h>
+
+// Lane filler that no circle can touch
+static constexpr Bounds c_empty_bounds{ { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+
+Bounds BlockGrid::Cell::bounds(size_t i) const
+{
+	return { { min_x[i], min_y[i] }, { max_x[i], max_y[i] } };
+}
+
+void BlockGrid::Cell::set(size_t i, const Bounds& bounds)
+{
+	min_x[i] = bounds.min.x;
+	min_y[i] = bounds.min.y;
+	max_x[i] = bounds.max.x;
+	max_y[i] = bounds.max.y;
+}
+
+int32_t BlockGrid::cell_x(float x) const
+{
+	return fmath::clamp((int32_t)((x - m_bounds.min.x) / m_cell_size.x), 0, m_cols - 1);
+}
+
+int32_t BlockGrid::cell_y(float y) const
+{
+	return fmath::clamp((int32_t)((y - m_bounds.min.y) / m_cell_size.y), 0, m_rows - 1);
+}
+
+BlockGrid::Cell& BlockGrid::cell_at(const Vector2& position)
+{
+	return m_cells[(size_t)cell_y(position.y) * m_cols + cell_x(position.x)];
+}
+
+void BlockGrid::reset(const Bounds& bounds, Vector2 cell_size)
+{
+	m_bounds    = bounds;
+	m_cell_size = cell_size;
+	m_cols      = fmath::max((int32_t)ceilf((bounds.max.x - bounds.min.x) / cell_size.x), 1);
+	m_rows      = fmath::max((int32_t)ceilf((bounds.max.y - bounds.min.y) / cell_size.y), 1);
+
+	m_cells.clear();
+	m_cells.resize((size_t)m_cols * m_rows);
+	m_size = 0;
+	m_max_half_extent = {};
+}
+
+void BlockGrid::clear()
+{
+	// Keep cell capacity, next level will most likely have a similar layout
+	for (Cell& cell : m_cells)
+	{
+		cell.entities.clear();
+		cell.min_x.clear();
+		cell.min_y.clear();
+		cell.max_x.clear();
+		cell.max_y.clear();
+	}
+	m_size = 0;
+	m_max_half_extent = {};
+}
+
+void BlockGrid::rebuild(entt::registry* registry)
+{
+	clear();
+
+	auto block_view = registry->view<Block, Transform, Collider>();
+	for (auto [entity, transform] : block_view.each())
+	{
+		insert(entity, fmath::transform_to_rect(transform));
+	}
+}
+
+void BlockGrid::insert(entt::entity entity, const Rect& rect)
+{
+	Cell& cell = cell_at(rect.position);
+	const size_t index = cell.entities.size();
+	cell.entities.push_back(entity);
+
+	// Grow lanes by a whole batch
+	if (index == cell.min_x.size())
+	{
+		const size_t lanes = index + fmath::batch_width;
+		cell.min_x.resize(lanes, c_empty_bounds.min.x);
+		cell.min_y.resize(lanes, c_empty_bounds.min.y);
+		cell.max_x.resize(lanes, c_empty_bounds.max.x);
+		cell.max_y.resize(lanes, c_empty_bounds.max.y);
+	}
+
+	cell.set(index, fmath::rect_to_bounds(rect));
+	++m_size;
+
+	m_max_half_extent = {
+		fmath::max(m_max_half_extent.x, rect.dimensions.x / 2.0f),
+		fmath::max(m_max_half_extent.y, rect.dimensions.y / 2.0f)
+	};
+}
+
+bool BlockGrid::remove(entt::entity entity, const Rect& rect)
+{
+	Cell& cell = cell_at(rect.position);
+	auto it = std::find(cell.entities.begin(), cell.entities.end(), entity);
+	if (it == cell.entities.end())
+	{
+		return false;
+	}
+
+	// Swap with the last one, order inside of a cell doesn't matter
+	const size_t index = it - cell.entities.begin();
+	const size_t last  = cell.entities.size() - 1;
+	cell.entities[index] = cell.entities[last];
+	cell.set(index, cell.bounds(last));
+	cell.set(last, c_empty_bounds);
+	cell.entities.pop_back();
+
+	// Drop a batch that became pure padding
+	if (cell.min_x.size() - cell.entities.size() >= fmath::batch_width)
+	{
+		const size_t lanes = cell.min_x.size() - fmath::batch_width;
+		cell.min_x.resize(lanes);
+		cell.min_y.resize(lanes);
+		cell.max_x.resize(lanes);
+		cell.max_y.resize(lanes);
+	}
+	--m_size;
+	return true;
+}
+
+size_t BlockGrid::size() const
+{
+	return m_size;
+}
+
+BlockGrid::BlockGrid(const Bounds& bounds, Vector2 cell_size)
+{
+	reset(bounds, cell_size);
+}
+
+BlockGrid::BlockGrid()
+{
+}
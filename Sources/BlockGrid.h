@@ -0,0 +1,165 @@
+#pragma once
+#include "FMath.h"
+
+#include <stdint.h>
+#include <new>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+// Allocator for arrays consumed by the batched fmath kernels
+template<class t, size_t alignment>
+struct AlignedAllocator
+{
+	using value_type = t;
+
+	template<class u>
+	struct rebind { using other = AlignedAllocator<u, alignment>; };
+
+	t* allocate(size_t n)
+	{
+		return static_cast<t*>(::operator new(n * sizeof(t), std::align_val_t(alignment)));
+	}
+
+	void deallocate(t* p, size_t)
+	{
+		::operator delete(p, std::align_val_t(alignment));
+	}
+
+	AlignedAllocator() = default;
+	template<class u>
+	AlignedAllocator(const AlignedAllocator<u, alignment>&) {}
+
+	template<class u>
+	bool operator==(const AlignedAllocator<u, alignment>&) const { return true; }
+	template<class u>
+	bool operator!=(const AlignedAllocator<u, alignment>&) const { return false; }
+};
+
+// Uniform grid over static block bounds.
+// Every block is binned once by its center, queries are expanded by the largest half extent,
+// so a block is never reported twice and no deduplication is needed.
+// Full height queries (lasers) degenerate into a lookup of the column range under them.
+// Queries keep no scratch state, any number of threads may query while nobody inserts or removes.
+class BlockGrid final
+{
+private:
+	using Lane = std::vector<float, AlignedAllocator<float, fmath::batch_alignment>>;
+
+	// Block bounds as a struct of arrays, padded with empty bounds up to fmath::batch_width
+	struct Cell
+	{
+		std::vector<entt::entity> entities;
+		Lane min_x;
+		Lane min_y;
+		Lane max_x;
+		Lane max_y;
+
+		Bounds bounds(size_t i) const;
+		void   set(size_t i, const Bounds& bounds);
+	};
+
+	Bounds  m_bounds{};
+	Vector2 m_cell_size{ 1.0f, 1.0f };
+	int32_t m_cols{ 0 };
+	int32_t m_rows{ 0 };
+	size_t  m_size{ 0 };
+
+	// Largest block half extent inserted since the last clear
+	Vector2 m_max_half_extent{};
+
+	std::vector<Cell> m_cells;
+
+	int32_t cell_x(float x) const;
+	int32_t cell_y(float y) const;
+	Cell&   cell_at(const Vector2& position);
+
+public:
+	void reset(const Bounds& bounds, Vector2 cell_size);
+	void clear();
+	void rebuild(entt::registry* registry);
+
+	void insert(entt::entity entity, const Rect& rect);
+	bool remove(entt::entity entity, const Rect& rect);
+
+	size_t size() const;
+
+	// Calls fun(entity, block_bounds) for every block that could overlap bounds.
+	// Stops early and returns false when fun returns false.
+	template<class fn>
+	bool query(const Bounds& bounds, fn&& fun) const
+	{
+		if (m_size == 0)
+		{
+			return true;
+		}
+
+		const int32_t x0 = cell_x(bounds.min.x - m_max_half_extent.x);
+		const int32_t x1 = cell_x(bounds.max.x + m_max_half_extent.x);
+		const int32_t y0 = cell_y(bounds.min.y - m_max_half_extent.y);
+		const int32_t y1 = cell_y(bounds.max.y + m_max_half_extent.y);
+
+		for (int32_t y = y0; y <= y1; ++y)
+		{
+			for (int32_t x = x0; x <= x1; ++x)
+			{
+				const Cell& cell = m_cells[(size_t)y * m_cols + x];
+				for (size_t i = 0; i < cell.entities.size(); ++i)
+				{
+					if (!fun(cell.entities[i], cell.bounds(i)))
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Same as above, but only reports blocks touching the circle, tested fmath::batch_width at a time
+	template<class fn>
+	bool query(const Circle& circle, fn&& fun) const
+	{
+		if (m_size == 0)
+		{
+			return true;
+		}
+
+		const Bounds bounds{ fmath::rect_to_bounds(fmath::circle_to_rect(circle)) };
+		const int32_t x0 = cell_x(bounds.min.x - m_max_half_extent.x);
+		const int32_t x1 = cell_x(bounds.max.x + m_max_half_extent.x);
+		const int32_t y0 = cell_y(bounds.min.y - m_max_half_extent.y);
+		const int32_t y1 = cell_y(bounds.max.y + m_max_half_extent.y);
+
+		for (int32_t y = y0; y <= y1; ++y)
+		{
+			for (int32_t x = x0; x <= x1; ++x)
+			{
+				const Cell& cell = m_cells[(size_t)y * m_cols + x];
+				for (size_t batch = 0; batch < cell.entities.size(); batch += fmath::batch_width)
+				{
+					uint32_t mask = fmath::has_intersection_batch(circle,
+						cell.min_x.data() + batch, cell.min_y.data() + batch,
+						cell.max_x.data() + batch, cell.max_y.data() + batch);
+
+					// Padding lanes never hit
+					while (mask != 0)
+					{
+						const size_t i = batch + fmath::lowest_bit(mask);
+						mask &= mask - 1;
+						if (!fun(cell.entities[i], cell.bounds(i)))
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	BlockGrid(const Bounds& bounds, Vector2 cell_size);
+	BlockGrid();
+};
@@ -0,0 +1,163 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+size_t CommandBuffer::get_queue_index() const
+{
+	return m_thread_pool ? m_thread_pool->get_thread_index() : 0;
+}
+
+CommandBuffer::Queue& CommandBuffer::get_queue()
+{
+	return *m_queues[get_queue_index()];
+}
+
+void CommandBuffer::destroy(entt::entity entity)
+{
+	get_queue().destroys.push_back(entity);
+}
+
+void CommandBuffer::custom(CustomCommand&& fun)
+{
+	get_queue().customs.push_back({ m_sequence++, std::move(fun) });
+}
+
+void CommandBuffer::flush(entt::registry& registry)
+{
+	// Custom commands
+	m_customs.clear();
+	for (auto& queue : m_queues)
+	{
+		for (SequencedCustom& custom : queue->customs)
+		{
+			m_customs.push_back(&custom);
+		}
+	}
+	std::sort(m_customs.begin(), m_customs.end(), [](const SequencedCustom* first, const SequencedCustom* second)
+	{
+		return first->sequence < second->sequence;
+	});
+	for (SequencedCustom* custom : m_customs)
+	{
+		custom->fun(registry);
+	}
+
+	// Spawns, grouped by archetype in order of first appearance
+	m_spawns.clear();
+	for (auto& queue : m_queues)
+	{
+		m_spawns.insert(m_spawns.end(), queue->spawns.begin(), queue->spawns.end());
+	}
+	std::sort(m_spawns.begin(), m_spawns.end(), [](const SpawnCommand& first, const SpawnCommand& second)
+	{
+		return first.sequence < second.sequence;
+	});
+
+	m_archetypes.clear();
+	for (const SpawnCommand& spawn : m_spawns)
+	{
+		if (std::find(m_archetypes.begin(), m_archetypes.end(), spawn.fn) == m_archetypes.end())
+		{
+			m_archetypes.push_back(spawn.fn);
+		}
+	}
+
+	for (const SpawnFn fn : m_archetypes)
+	{
+		m_items.clear();
+		for (const SpawnCommand& spawn : m_spawns)
+		{
+			if (spawn.fn == fn)
+			{
+				m_items.push_back(m_queues[spawn.queue]->arena.data() + spawn.offset);
+			}
+		}
+		fn(registry, m_items.data(), m_items.size());
+	}
+
+	// Tags, grouped by component
+	m_tags.clear();
+	for (auto& queue : m_queues)
+	{
+		m_tags.insert(m_tags.end(), queue->tags.begin(), queue->tags.end());
+	}
+	std::sort(m_tags.begin(), m_tags.end(), [](const TagCommand& first, const TagCommand& second)
+	{
+		return first.fn != second.fn ? std::less<TagFn>{}(first.fn, second.fn) : first.entity < second.entity;
+	});
+	for (size_t i = 0; i < m_tags.size();)
+	{
+		const TagFn fn = m_tags[i].fn;
+
+		m_entities.clear();
+		for (; i < m_tags.size() && m_tags[i].fn == fn; ++i)
+		{
+			m_entities.push_back(m_tags[i].entity);
+		}
+		m_entities.erase(std::unique(m_entities.begin(), m_entities.end()), m_entities.end());
+		m_entities.erase(std::remove_if(m_entities.begin(), m_entities.end(), [&](entt::entity entity)
+		{
+			return !registry.valid(entity);
+		}), m_entities.end());
+
+		fn(registry, m_entities);
+	}
+
+	// Destroys
+	m_entities.clear();
+	for (auto& queue : m_queues)
+	{
+		m_entities.insert(m_entities.end(), queue->destroys.begin(), queue->destroys.end());
+	}
+	std::sort(m_entities.begin(), m_entities.end());
+	m_entities.erase(std::unique(m_entities.begin(), m_entities.end()), m_entities.end());
+	m_entities.erase(std::remove_if(m_entities.begin(), m_entities.end(), [&](entt::entity entity)
+	{
+		return !registry.valid(entity);
+	}), m_entities.end());
+	registry.destroy(m_entities.begin(), m_entities.end());
+
+	clear();
+}
+
+void CommandBuffer::clear()
+{
+	for (auto& queue : m_queues)
+	{
+		queue->destroys.clear();
+		queue->tags.clear();
+		queue->spawns.clear();
+		queue->customs.clear();
+		queue->arena.clear();
+	}
+	m_sequence = 0;
+}
+
+bool CommandBuffer::empty() const
+{
+	for (const auto& queue : m_queues)
+	{
+		if (!queue->destroys.empty() || !queue->tags.empty() || !queue->spawns.empty() || !queue->customs.empty())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+CommandBuffer::CommandBuffer(const ThreadPool* thread_pool) : m_thread_pool(thread_pool)
+{
+	const size_t queue_count = m_thread_pool ? m_thread_pool->get_thread_count() : 1;
+	for (size_t i = 0; i < queue_count; ++i)
+	{
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+}
+
+CommandBuffer::CommandBuffer() : CommandBuffer(nullptr)
+{
+}
+
+CommandBuffer::~CommandBuffer()
+{
+}
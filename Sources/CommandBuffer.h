@@ -0,0 +1,132 @@
+#pragma once
+#include "InlineFunction.h"
+#include "ThreadPool.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+using CustomCommand = InlineFunction<void(entt::registry&), 64>;
+
+// Structural registry changes recorded while systems iterate, applied together by flush().
+// Every pool thread records into its own queue, so recording never blocks.
+//
+// flush() applies, in this order:
+//  - custom commands, in recording order
+//  - spawns, one bulk call per archetype, in recording order
+//  - tags, sorted by entity and deduplicated, one bulk insert per component
+//  - destroys, sorted by entity and deduplicated, one bulk destroy
+// Recording order is only defined between recorders that don't run concurrently,
+// sorted commands don't depend on it at all.
+class CommandBuffer final
+{
+private:
+	using TagFn   = void(*)(entt::registry& registry, std::vector<entt::entity>& entities);
+	using SpawnFn = void(*)(entt::registry& registry, const void* const* items, size_t count);
+
+	struct TagCommand
+	{
+		TagFn        fn;
+		entt::entity entity;
+	};
+
+	struct SpawnCommand
+	{
+		uint32_t sequence;
+		uint32_t queue;
+		SpawnFn  fn;
+		size_t   offset;
+	};
+
+	struct SequencedCustom
+	{
+		uint32_t      sequence;
+		CustomCommand fun;
+	};
+
+	struct Queue
+	{
+		std::vector<entt::entity>    destroys;
+		std::vector<TagCommand>      tags;
+		std::vector<SpawnCommand>    spawns;
+		std::vector<SequencedCustom> customs;
+
+		// Spawn payloads, 8 byte aligned
+		std::vector<uint64_t>        arena;
+	};
+
+	const ThreadPool* m_thread_pool{ nullptr };
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::atomic<uint32_t> m_sequence{ 0 };
+
+	// Reused by flush
+	std::vector<entt::entity>          m_entities;
+	std::vector<TagCommand>            m_tags;
+	std::vector<SpawnCommand>          m_spawns;
+	std::vector<SpawnFn>               m_archetypes;
+	std::vector<const void*>           m_items;
+	std::vector<SequencedCustom*>      m_customs;
+
+	size_t get_queue_index() const;
+	Queue& get_queue();
+
+	template<class component>
+	static void insert_tag(entt::registry& registry, std::vector<entt::entity>& entities)
+	{
+		entities.erase(std::remove_if(entities.begin(), entities.end(), [&](entt::entity entity)
+		{
+			return registry.has<component>(entity);
+		}), entities.end());
+		registry.insert<component>(entities.begin(), entities.end());
+	}
+
+	template<class archetype>
+	static void spawn_items(entt::registry& registry, const void* const* items, size_t count)
+	{
+		archetype::spawn(registry, reinterpret_cast<const archetype* const*>(items), count);
+	}
+
+public:
+	void destroy(entt::entity entity);
+
+	// Adds an empty component, entities that already have it or get destroyed are skipped
+	template<class component>
+	void tag(entt::entity entity)
+	{
+		static_assert(std::is_empty_v<component>, "Only empty components are recorded as tags");
+		get_queue().tags.push_back({ &insert_tag<component>, entity });
+	}
+
+	// archetype::spawn(registry, const archetype* const* items, size_t count) creates all of them at once
+	template<class archetype>
+	void spawn(const archetype& item)
+	{
+		static_assert(std::is_trivially_copyable_v<archetype>, "Spawn payloads are copied as bytes");
+		static_assert(alignof(archetype) <= alignof(uint64_t), "Spawn payload is over-aligned");
+
+		const size_t queue_index = get_queue_index();
+		Queue& queue = *m_queues[queue_index];
+		const size_t offset = queue.arena.size();
+		queue.arena.resize(offset + (sizeof(archetype) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+		memcpy(queue.arena.data() + offset, &item, sizeof(archetype));
+		queue.spawns.push_back({ m_sequence++, (uint32_t)queue_index, &spawn_items<archetype>, offset });
+	}
+
+	// For changes that need the entity of something that doesn't exist yet
+	void custom(CustomCommand&& fun);
+
+	void flush(entt::registry& registry);
+	void clear();
+	bool empty() const;
+
+	CommandBuffer(const ThreadPool* thread_pool);
+	CommandBuffer();
+	~CommandBuffer();
+	CommandBuffer(CommandBuffer&) = delete;
+};
@@ -17,9 +17,34 @@ constexpr Vector2 g_game_center_s{ g_game_center * g_scale };
 constexpr float   g_ball_start_velocity{ 320.0f * g_scale };
 constexpr float   g_ball_radius{ 6.0f * g_scale };
 
+// Contacts resolved per ball per fixed step
+constexpr uint32_t g_ball_max_bounces{ 4 };
+
+// Balls are simulated in chunks on the thread pool once there are enough of them
+constexpr uint32_t g_ball_chunk_size{ 128 };
+constexpr uint32_t g_ball_parallel_threshold{ 512 };
+
 constexpr float   g_platform_velocity{ 460.0f * g_scale };
 constexpr float   g_platform_elevation{ 10.0f * g_scale };
 constexpr Vector2 g_platform_dimensions{ 42.0f * g_scale, 10.0f * g_scale };
 
+// Mixer device format, larcanoid_pack converts sounds to it ahead of time
+constexpr int32_t  g_audio_frequency{ 44100 };
+constexpr int32_t  g_audio_channels{ 2 };
+
+// New voices started per frame, the rest of the frame's sounds are dropped by priority
+constexpr uint32_t g_audio_voice_budget{ 4 };
+
+// Broadphase cell, a bit larger than a block
+constexpr Vector2 g_block_grid_cell{ 48.0f * g_scale, 48.0f * g_scale };
+
+// Sprites are interpolated between fixed steps, a lower rate stays smooth on screen
 static constexpr uint64_t g_fixed_frame_rate = 120;
-static constexpr double   g_fixed_delta_time = 1.0 / g_fixed_frame_rate;
\ No newline at end of file
+static constexpr double   g_fixed_delta_time = 1.0 / g_fixed_frame_rate;
+
+// Frame pacing, the target is a default of EngineSettings, idle frames only wake up for events
+static constexpr uint32_t g_target_frame_rate = 144;
+static constexpr uint32_t g_idle_frame_rate   = 30;
+
+// Fixed steps run by one frame at most, time behind that is dropped to avoid a spiral of death
+static constexpr uint32_t g_max_catch_up_steps = 8;
\ No newline at end of file
@@ -1,12 +1,22 @@
 #include "Engine.h"
 #include "FMath.h"
+#include "Profiler.h"
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <SDL_image.h>
 #include <SDL_mixer.h>
+#include <stdio.h>
+#include <random>
 
 void Engine::process()
 {
+	if (m_settings.headless)
+	{
+		process_headless();
+		return;
+	}
+
+	wait_for_frame();
 	process_os_events();
 
 	// This part of code could be moved to another thread in real-time OS.
@@ -17,22 +27,112 @@ void Engine::process()
 		const uint64_t delta_tick = perf_tick - m_prev_tick;
 		const float    delta_time = delta_tick / (float)perf_freq;
 
-		constexpr float e = 1e-15F;
-		if (delta_time > e)
-		{
-			update(delta_time);
-		}
-
 		const uint64_t fixed_tick_duration = (uint64_t)(g_fixed_delta_time * perf_freq);
-		const uint64_t target_frame = (perf_tick - m_start_tick) / fixed_tick_duration;
-		while (m_fixed_last_frame < target_frame)
+		const uint64_t target_frame = (perf_tick - m_fixed_start_tick) / fixed_tick_duration;
+
+		uint32_t steps = 0;
+		while (m_fixed_last_frame < target_frame && (m_settings.max_catch_up_steps == 0 || steps < m_settings.max_catch_up_steps))
 		{
 			++m_fixed_last_frame;
+			++steps;
 			fixed_update();
 		}
 
+		// Stepping everything we're behind would only put us further behind, continue from now instead
+		if (m_fixed_last_frame < target_frame)
+		{
+			const uint64_t dropped = target_frame - m_fixed_last_frame;
+			m_fixed_start_tick += dropped * fixed_tick_duration;
+			m_dropped_frames   += dropped;
+
+			SDL_Log("Simulation fell behind, dropped %llu fixed steps (%.1f ms)", (unsigned long long)dropped, dropped * g_fixed_delta_time * 1000.0);
+		}
+
+		// Fixed steps are done first, so the frame draws between the last two of them
+		const uint64_t since_step = perf_tick - m_fixed_start_tick - m_fixed_last_frame * fixed_tick_duration;
+		const float    blend      = fmath::clamp(since_step / (float)fixed_tick_duration, 0.0f, 1.0f);
+
+		constexpr float e = 1e-15F;
+		if (delta_time > e)
+		{
+			update(delta_time, blend);
+		}
+
 		m_prev_tick = perf_tick;
 	}
+
+	PROFILE_FRAME();
+}
+
+void Engine::process_headless()
+{
+	process_os_events();
+
+	// Simulated time only, one fixed frame per call
+	update((float)g_fixed_delta_time, 1.0f);
+
+	++m_fixed_last_frame;
+	fixed_update();
+
+	PROFILE_FRAME();
+
+	const bool frames_done = m_settings.max_frames > 0 && m_fixed_last_frame >= m_settings.max_frames;
+	const bool time_done   = m_settings.max_simulated_time > 0.0 && m_fixed_last_frame * g_fixed_delta_time >= m_settings.max_simulated_time;
+	const bool replay_done = m_is_replaying && m_recording.is_finished();
+	if (frames_done || time_done || replay_done)
+	{
+		m_should_quit = true;
+	}
+}
+
+void Engine::wait_for_frame()
+{
+	PROFILE_ZONE("Engine::wait_for_frame");
+
+	const bool     idle       = is_idle();
+	const uint32_t frame_rate = idle ? g_idle_frame_rate : m_settings.target_frame_rate;
+	if (frame_rate == 0)
+	{
+		return;
+	}
+
+	const uint64_t perf_freq   = SDL_GetPerformanceFrequency();
+	const uint64_t frame_ticks = perf_freq / frame_rate;
+	const uint64_t deadline    = m_frame_tick + frame_ticks;
+
+	uint64_t now = SDL_GetPerformanceCounter();
+	if (idle)
+	{
+		// Any event ends the wait early
+		if (now < deadline)
+		{
+			SDL_Event e;
+			if (SDL_WaitEventTimeout(&e, (int)((deadline - now) * 1000 / perf_freq)) != 0)
+			{
+				handle_os_event(e);
+			}
+			now = SDL_GetPerformanceCounter();
+		}
+	}
+	else
+	{
+		// Sleep while the OS can be trusted to wake us in time, spin the last couple of milliseconds
+		constexpr uint64_t spin_ms = 2;
+		const uint64_t spin_ticks = perf_freq * spin_ms / 1000;
+		while (now + spin_ticks < deadline)
+		{
+			SDL_Delay(1);
+			now = SDL_GetPerformanceCounter();
+		}
+		while (now < deadline)
+		{
+			now = SDL_GetPerformanceCounter();
+		}
+	}
+
+	// Keep the cadence after a slightly late frame, start over after an early wake up or a long stall
+	const bool on_time = now >= deadline && now - deadline < frame_ticks;
+	m_frame_tick = on_time ? deadline : now;
 }
 
 bool Engine::is_quit_requested() const
@@ -45,20 +145,84 @@ void Engine::request_quit()
     m_should_quit = true;
 }
 
-void Engine::update(float delta_time)
+bool Engine::is_headless() const
+{
+	return m_settings.headless;
+}
+
+bool Engine::is_replaying() const
+{
+	return m_is_replaying;
+}
+
+uint64_t Engine::get_seed() const
+{
+	return m_recording.seed;
+}
+
+uint32_t Engine::get_recording_flags() const
+{
+	return m_recording.flags;
+}
+
+void Engine::set_recording_flags(uint32_t flags)
 {
+	if (m_is_recording)
+	{
+		m_recording.flags = flags;
+	}
+}
+
+bool Engine::is_idle() const
+{
+	for (const auto& m : m_actors)
+	{
+		if (!m->is_idle())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+SimulationStats Engine::get_simulation_stats() const
+{
+	SimulationStats stats;
+	stats.frames         = m_fixed_last_frame;
+	stats.simulated_time = m_fixed_last_frame * g_fixed_delta_time;
+	stats.wall_time      = (SDL_GetPerformanceCounter() - m_start_tick) / (double)SDL_GetPerformanceFrequency();
+	if (stats.wall_time > 0.0)
+	{
+		stats.frames_per_second = stats.frames / stats.wall_time;
+	}
+	stats.dropped_frames = m_dropped_frames;
+	stats.dropped_time   = m_dropped_frames * g_fixed_delta_time;
+	return stats;
+}
+
+void Engine::update(float delta_time, float blend)
+{
+	PROFILE_ZONE("Engine::update");
+
 	for (auto& m : m_actors)
 	{
 		m->on_update(delta_time);
 	}
 
-	// Rendering could be done in separate thread
-	// In our case this doesn't matter
-	render();
+	if (m_render_thread.joinable())
+	{
+		publish_snapshot(blend);
+	}
+	else if (!m_settings.headless)
+	{
+		render(blend);
+	}
 }
 
 void Engine::fixed_update()
 {
+	PROFILE_ZONE("Engine::fixed_update");
+
 	for (auto& m : m_actors)
 	{
 		m->on_fixed_update();
@@ -70,40 +234,182 @@ void Engine::fixed_update()
 	process_inputs();
 }
 
-void Engine::render()
+void Engine::render(float blend)
 {
+	PROFILE_ZONE("Engine::render");
+
 	SDL_RenderClear(m_sdl_renderer);
 
 	for (auto& m : m_actors)
 	{
-		m->on_render(m_sdl_renderer);
+		m->on_render(m_sdl_renderer, blend);
 	}
 
 	SDL_SetRenderDrawColor(m_sdl_renderer, 0, 0, 0, 255);
-	SDL_RenderPresent(m_sdl_renderer);
+	{
+		PROFILE_ZONE("SDL_RenderPresent");
+		SDL_RenderPresent(m_sdl_renderer);
+	}
 }
 
-void Engine::process_inputs()
+void Engine::publish_snapshot(float blend)
 {
-	int length = 0;
-	const Uint8* kb_state = SDL_GetKeyboardState(&length);
-	if (kb_state[SDL_SCANCODE_LEFT])
+	PROFILE_ZONE("Engine::publish_snapshot");
+
+	RenderFrame& frame = m_render_frames.get_back();
+	frame.resize(m_actors.size());
+	for (size_t i = 0; i < m_actors.size(); ++i)
 	{
-		call_on_input(EInputEvent::left, m_kb_state[SDL_SCANCODE_LEFT] != kb_state[SDL_SCANCODE_LEFT]);
+		frame[i].clear();
+		m_actors[i]->on_snapshot(frame[i], blend);
 	}
-	if (kb_state[SDL_SCANCODE_RIGHT])
+	m_render_frames.publish();
+
 	{
-		call_on_input(EInputEvent::right, m_kb_state[SDL_SCANCODE_RIGHT] != kb_state[SDL_SCANCODE_RIGHT]);
+		std::lock_guard<std::mutex> lock(m_render_mutex);
+		++m_published_frames;
 	}
-	if (kb_state[SDL_SCANCODE_SPACE])
+	m_render_wake.notify_one();
+}
+
+void Engine::render_frame(const RenderFrame& frame)
+{
+	PROFILE_ZONE("Engine::render_frame");
+
+	SDL_RenderClear(m_sdl_renderer);
+
 	{
-		call_on_input(EInputEvent::space, m_kb_state[SDL_SCANCODE_SPACE] != kb_state[SDL_SCANCODE_SPACE]);
+		std::lock_guard<std::mutex> lock(m_actors_mutex);
+		const size_t count = fmath::min(m_actors.size(), frame.size());
+		for (size_t i = 0; i < count; ++i)
+		{
+			m_actors[i]->on_render_snapshot(m_sdl_renderer, frame[i]);
+		}
 	}
-	if (kb_state[SDL_SCANCODE_ESCAPE])
+
+	SDL_SetRenderDrawColor(m_sdl_renderer, 0, 0, 0, 255);
+	{
+		PROFILE_ZONE("SDL_RenderPresent");
+		SDL_RenderPresent(m_sdl_renderer);
+	}
+}
+
+void Engine::render_thread_main()
+{
+	// SDL renderers are bound to the thread that created them
+	m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, 0);
+
+	std::vector<RenderJob> jobs;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_render_mutex);
+			m_render_wake.wait(lock, [this]()
+			{
+				return m_render_stop || !m_render_jobs.empty() || m_rendered_frames != m_published_frames;
+			});
+			if (m_render_stop)
+			{
+				break;
+			}
+			jobs.swap(m_render_jobs);
+			m_rendered_frames = m_published_frames;
+		}
+
+		for (RenderJob& job : jobs)
+		{
+			job();
+		}
+		jobs.clear();
+
+		// Frames published during the last present are skipped, only the latest one is drawn
+		if (m_render_frames.acquire())
+		{
+			render_frame(m_render_frames.get_front());
+		}
+	}
+
+	// Actors own textures of this renderer
 	{
-		call_on_input(EInputEvent::escape, m_kb_state[SDL_SCANCODE_ESCAPE] != kb_state[SDL_SCANCODE_ESCAPE]);
+		std::lock_guard<std::mutex> lock(m_actors_mutex);
+		m_actors.clear();
 	}
-	memcpy(m_kb_state, kb_state, fmath::min(length, (int)c_kb_size));
+	SDL_DestroyRenderer(m_sdl_renderer);
+	m_sdl_renderer = nullptr;
+}
+
+void Engine::construct_actor(Actor& actor)
+{
+	if (!m_render_thread.joinable())
+	{
+		actor.on_construct(m_sdl_renderer, &registry);
+		return;
+	}
+
+	bool done = false;
+	std::unique_lock<std::mutex> lock(m_render_mutex);
+	m_render_jobs.push_back([this, &actor, &done]()
+	{
+		actor.on_construct(m_sdl_renderer, &registry);
+
+		std::lock_guard<std::mutex> done_lock(m_render_mutex);
+		done = true;
+		m_render_wake.notify_all();
+	});
+	m_render_wake.notify_all();
+	m_render_wake.wait(lock, [&done]() { return done; });
+}
+
+void Engine::stop_render_thread()
+{
+	if (!m_render_thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_render_mutex);
+		m_render_stop = true;
+	}
+	m_render_wake.notify_all();
+	m_render_thread.join();
+}
+
+InputMask Engine::sample_inputs() const
+{
+	// There is no keyboard without a window
+	if (m_settings.headless)
+	{
+		return 0;
+	}
+
+	const Uint8* kb_state = SDL_GetKeyboardState(nullptr);
+	InputMask mask = 0;
+	mask |= kb_state[SDL_SCANCODE_LEFT]   ? 1 << (int)EInputEvent::left   : 0;
+	mask |= kb_state[SDL_SCANCODE_RIGHT]  ? 1 << (int)EInputEvent::right  : 0;
+	mask |= kb_state[SDL_SCANCODE_SPACE]  ? 1 << (int)EInputEvent::space  : 0;
+	mask |= kb_state[SDL_SCANCODE_ESCAPE] ? 1 << (int)EInputEvent::escape : 0;
+	return mask;
+}
+
+void Engine::process_inputs()
+{
+	const InputMask mask = m_is_replaying ? m_recording.next() : sample_inputs();
+	if (m_is_recording)
+	{
+		m_recording.push(mask);
+	}
+
+	constexpr EInputEvent events[]{ EInputEvent::left, EInputEvent::right, EInputEvent::space, EInputEvent::escape };
+	for (const EInputEvent e : events)
+	{
+		const InputMask bit = (InputMask)(1 << (int)e);
+		if (mask & bit)
+		{
+			call_on_input(e, (m_input_mask & bit) == 0);
+		}
+	}
+	m_input_mask = mask;
 }
 
 void Engine::call_on_input(EInputEvent e, bool changed)
@@ -116,20 +422,60 @@ void Engine::call_on_input(EInputEvent e, bool changed)
 
 void Engine::process_os_events()
 {
+	PROFILE_ZONE("Engine::process_os_events");
+
 	SDL_Event e;
-	if (SDL_PollEvent(&e) != 0)
+	while (SDL_PollEvent(&e) != 0)
 	{
-		switch (e.type)
+		handle_os_event(e);
+	}
+}
+
+void Engine::handle_os_event(const SDL_Event& e)
+{
+	switch (e.type)
+	{
+	case SDL_QUIT:
+		m_should_quit = true;
+		break;
+	}
+}
+
+Engine::Engine(const EngineSettings& settings) : m_settings(settings)
+{
+	// A replay has no use for a window, it runs as fast as the simulation can
+	if (m_settings.replay_path)
+	{
+		m_settings.headless = true;
+		m_is_replaying = m_recording.load(m_settings.replay_path);
+		if (!m_is_replaying)
 		{
-		case SDL_QUIT:
+			printf("Failed to load replay %s\n", m_settings.replay_path);
 			m_should_quit = true;
-			break;
+			return;
 		}
 	}
-}
+	else
+	{
+		m_recording.seed = m_settings.seed != 0 ? m_settings.seed : std::random_device{}();
+		m_is_recording   = m_settings.record_path != nullptr;
+	}
+
+	if (m_settings.headless)
+	{
+		// Only timers and events, actors get a null renderer
+		if (SDL_Init(SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0)
+		{
+			m_should_quit = true;
+			return;
+		}
+
+		m_start_tick       = SDL_GetPerformanceCounter();
+		m_prev_tick        = m_start_tick;
+		m_fixed_start_tick = m_start_tick;
+		return;
+	}
 
-Engine::Engine()
-{
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
 	{
 		m_should_quit = true;
@@ -155,26 +501,61 @@ Engine::Engine()
 		return;
 	}
 
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024) == -1)
+	if (Mix_OpenAudio(g_audio_frequency, MIX_DEFAULT_FORMAT, g_audio_channels, 1024) == -1)
 	{
 		m_should_quit = true;
 		return;
 	}
 
-	m_start_tick = SDL_GetPerformanceCounter();
-	m_prev_tick  = m_start_tick;
+	m_start_tick       = SDL_GetPerformanceCounter();
+	m_prev_tick        = m_start_tick;
+	m_frame_tick       = m_start_tick;
+	m_fixed_start_tick = m_start_tick;
 
-	m_sdl_window   = SDL_CreateWindow("Arcanoid", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, (int)g_screen_area_s.x, (int)g_screen_area_s.y, SDL_WINDOW_SHOWN );
-	m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, 0);
+	// Window and events stay on this thread
+	m_sdl_window = SDL_CreateWindow("Arcanoid", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, (int)g_screen_area_s.x, (int)g_screen_area_s.y, SDL_WINDOW_SHOWN );
+
+	if (m_settings.render_thread)
+	{
+		m_render_thread = std::thread(&Engine::render_thread_main, this);
+	}
+	else
+	{
+		m_sdl_renderer = SDL_CreateRenderer(m_sdl_window, -1, 0);
+	}
+}
+
+Engine::Engine() : Engine(EngineSettings{})
+{
 }
 
 Engine::~Engine()
 {
+	// The render thread releases the actors itself, they own its textures
+	stop_render_thread();
+
+	if (m_is_recording && !m_recording.save(m_settings.record_path))
+	{
+		printf("Failed to write recording %s\n", m_settings.record_path);
+	}
+
+	// Actors may own threads and SDL objects, release them while SDL is still up
+	m_actors.clear();
+
+	if (m_settings.headless)
+	{
+		SDL_Quit();
+		return;
+	}
+
+	Mix_CloseAudio();
 	Mix_Quit();
 	TTF_Quit();
 
-	// If I had a render thread, here I would've waited for it to finish
-	SDL_DestroyRenderer(m_sdl_renderer);
+	if (m_sdl_renderer)
+	{
+		SDL_DestroyRenderer(m_sdl_renderer);
+	}
 	SDL_DestroyWindow(m_sdl_window);
 	SDL_Quit();
 }
\ No newline at end of file
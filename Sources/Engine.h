@@ -1,25 +1,81 @@
 #pragma once
 #include "Config.h"
 #include "Actor.h"
+#include "InlineFunction.h"
+#include "InputRecording.h"
+#include "RenderSnapshot.h"
 
 #include <stdint.h>
 #include <type_traits>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <entt/entt.hpp>
 
+struct EngineSettings
+{
+	// No window, renderer or audio device, fixed frames are stepped as fast as possible
+	bool     headless{ false };
+
+	// Draw and present on a separate thread from snapshots, so a slow present never delays fixed_update
+	bool     render_thread{ false };
+
+	// Headless run limits, zero means unlimited
+	uint64_t max_frames{ 0 };
+	double   max_simulated_time{ 0.0 };
+
+	// Frames per second process() paces to, zero means as fast as possible
+	uint32_t target_frame_rate{ g_target_frame_rate };
+
+	// Fixed steps per process() before falling behind is dropped, zero means unlimited
+	uint32_t max_catch_up_steps{ g_max_catch_up_steps };
+
+	// Seed of the game's randomness, zero picks one
+	uint64_t seed{ 0 };
+
+	// Writes the input of every fixed frame and the seed on exit
+	const char* record_path{ nullptr };
+
+	// Feeds a recording back frame by frame, headless, quits after its last frame
+	const char* replay_path{ nullptr };
+};
+
+struct SimulationStats
+{
+	uint64_t frames{ 0 };
+	double   simulated_time{ 0.0 };
+	double   wall_time{ 0.0 };
+	double   frames_per_second{ 0.0 };
+
+	// Fixed steps skipped because a frame fell too far behind
+	uint64_t dropped_frames{ 0 };
+	double   dropped_time{ 0.0 };
+};
+
 class Engine final
 {
 private:
+	EngineSettings m_settings;
+
 	// Time counters
 	uint64_t m_start_tick = 0;
 	uint64_t m_prev_tick  = 0;
 	uint64_t m_delta_tick = 0;
 
+	// Start of the current frame for pacing
+	uint64_t m_frame_tick = 0;
+
+	// Fixed frame zero, moves forward when steps are dropped
+	uint64_t m_fixed_start_tick = 0;
+
 	// Last processed frame number
 	uint64_t m_fixed_last_frame = 0;
+	uint64_t m_dropped_frames   = 0;
 
 	bool m_should_quit = false;
 
@@ -28,39 +84,89 @@ private:
 
 	std::vector<std::shared_ptr<Actor>> m_actors;
 
-	// Store scancodes from the last frame
-	static constexpr size_t c_kb_size = 512;
-	uint8_t m_kb_state[c_kb_size]{};
+	// Render thread, owns m_sdl_renderer while running
+	using RenderJob   = InlineFunction<void()>;
+	using RenderFrame = std::vector<RenderSnapshot>;
+
+	std::thread                m_render_thread;
+	TripleBuffer<RenderFrame>  m_render_frames;
+	std::mutex                 m_render_mutex;
+	std::condition_variable    m_render_wake;
+	std::vector<RenderJob>     m_render_jobs;
+	uint64_t                   m_published_frames{ 0 };
+	uint64_t                   m_rendered_frames{ 0 };
+	bool                       m_render_stop{ false };
+
+	// Held by the render thread while it walks m_actors, and by create_actor while it grows it
+	std::mutex                 m_actors_mutex;
+
+	void render_thread_main();
+	void render_frame(const RenderFrame& frame);
+	void publish_snapshot(float blend);
+	void stop_render_thread();
+
+	// Runs on the render thread when there is one and waits for it
+	void construct_actor(Actor& actor);
+
+	// Keys held during the last fixed frame
+	InputMask m_input_mask{ 0 };
+
+	// Recorded or replayed input, see EngineSettings
+	InputRecording m_recording;
+	bool           m_is_recording{ false };
+	bool           m_is_replaying{ false };
 
 public:
 	entt::registry registry;
 
 	// Game lifetime
 	void process();
+	void process_headless();
 	bool is_quit_requested() const;
 	void request_quit();
 
-	void update(float delta_time);
+	bool is_headless() const;
+	bool is_idle() const;
+	bool is_replaying() const;
+
+	// Seed to derive all randomness from, taken from the replay when there is one
+	uint64_t get_seed() const;
+
+	// Game defined flags stored with a recording, read back from the replay
+	uint32_t get_recording_flags() const;
+	void     set_recording_flags(uint32_t flags);
+	SimulationStats get_simulation_stats() const;
+
+	void update(float delta_time, float blend);
 	void fixed_update();
-	void render();
+	void render(float blend);
 
 	void process_inputs();
+	InputMask sample_inputs() const;
 	void call_on_input(EInputEvent e, bool changed);
 	
+	// Sleeps, then spins until the next frame is due, idle frames wait for events instead
+	void wait_for_frame();
+
 	// SDL logic
 	void process_os_events();
+	void handle_os_event(const union SDL_Event& e);
 
 	template<class t, class ... params>
 	inline std::shared_ptr<t> create_actor(params ... args)
 	{
 		auto m = std::make_shared<t>(args...);
-		m_actors.push_back(m);
-		m->on_construct(m_sdl_renderer, &registry);
+		{
+			std::lock_guard<std::mutex> lock(m_actors_mutex);
+			m_actors.push_back(m);
+		}
+		construct_actor(*m);
 		return m;
 	}
 
 	inline bool release_actor(std::shared_ptr<Actor> Module)
 	{
+		std::lock_guard<std::mutex> lock(m_actors_mutex);
 		auto it = std::find(std::begin(m_actors), std::end(m_actors), Module);
 		if (it != std::end(m_actors))
 		{
@@ -70,6 +176,7 @@ public:
 		return false;
 	}
 
+	Engine(const EngineSettings& settings);
 	Engine();
 	~Engine();
 	Engine(Engine&) = delete;
@@ -1,7 +1,21 @@
 #pragma once
 #include <type_traits>
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+#include <stddef.h>
+#include <stdint.h>
 #include <math.h>
 
+// Batched intersection kernels, picked at compile time
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define FMATH_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define FMATH_SSE 1
+#endif
+
 struct Vector2
 {
 	float x{};
@@ -66,6 +80,20 @@ struct Circle
 	float   radius;
 };
 
+enum class EShape : uint8_t
+{
+	rect,
+	circle
+};
+
+// Placement of an entity (center, size), shape is data. Circles have equal dimensions.
+struct Transform
+{
+	Vector2 position;
+	Vector2 dimensions;
+	EShape  shape{ EShape::rect };
+};
+
 namespace fmath
 {
 	constexpr float PI = 3.14159265359f;
@@ -102,6 +130,14 @@ namespace fmath
 		};
 	}
 
+	constexpr Rect bounds_to_rect(const Bounds& bounds)
+	{
+		return {
+			{ (bounds.min.x + bounds.max.x) / 2.0f, (bounds.min.y + bounds.max.y) / 2.0f },
+			{ bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y }
+		};
+	}
+
 	constexpr Rect circle_to_rect(const Circle& c)
 	{
 		return {
@@ -110,11 +146,31 @@ namespace fmath
 		};
 	}
 
+	constexpr Rect transform_to_rect(const Transform& transform)
+	{
+		return { transform.position, transform.dimensions };
+	}
+
+	constexpr Circle transform_to_circle(const Transform& transform)
+	{
+		return { transform.position, transform.dimensions.x / 2.0f };
+	}
+
+	constexpr Transform circle_to_transform(const Circle& c)
+	{
+		return { c.position, { c.radius * 2, c.radius * 2 }, EShape::circle };
+	}
+
 	constexpr float magnitude_sqr(const Vector2& v)
 	{
 		return v.x * v.x + v.y * v.y;
 	}
 
+	constexpr Vector2 lerp(const Vector2& from, const Vector2& to, const float t)
+	{
+		return from + (to - from) * t;
+	}
+
 	inline Vector2 rotated(const Vector2& v, const float angle) {
 		float sin = sinf(angle);
 		float cos = cosf(angle);
@@ -138,6 +194,136 @@ namespace fmath
 		return fmath::rotated(Vector2{ 0.0f, -1 }, -a);
 	}
 
+	constexpr float dot(const Vector2& v1, const Vector2& v2)
+	{
+		return v1.x * v2.x + v1.y * v2.y;
+	}
+
+	// Reflect v against unit normal n
+	constexpr Vector2 reflected(const Vector2& v, const Vector2& n)
+	{
+		return v - n * (2.0f * dot(v, n));
+	}
+
+	// First t in [t_min, 1] at which point p + d * t is at distance r from center
+	inline bool ray_circle(const Vector2& p, const Vector2& d, const Vector2& center, const float r, const float t_min, float& t)
+	{
+		const Vector2 m = p - center;
+		const float a = dot(d, d);
+		const float b = dot(m, d);
+		const float c = dot(m, m) - r * r;
+		const float disc = b * b - a * c;
+		if (a <= 0.0f || disc < 0.0f)
+		{
+			return false;
+		}
+
+		t = (-b - sqrtf(disc)) / a;
+		return t >= t_min && t <= 1.0f;
+	}
+
+	// Circle c moving by delta against static bounds b.
+	// Returns time of impact as a fraction of delta and the contact normal.
+	// A circle that already overlaps b hits at t = 0, unless it is moving away.
+	inline bool sweep(const Circle& c, const Vector2& delta, const Bounds& b, float& toi, Vector2& normal)
+	{
+		const Vector2& p = c.position;
+		const float    r = c.radius;
+
+		// Already touching
+		const Vector2 closest{ clamp(p.x, b.min.x, b.max.x), clamp(p.y, b.min.y, b.max.y) };
+		const Vector2 offset{ p - closest };
+		const float   distance_sqr = magnitude_sqr(offset);
+		if (distance_sqr <= r * r)
+		{
+			if (distance_sqr > 0.0f)
+			{
+				normal = offset / sqrtf(distance_sqr);
+			}
+			else
+			{
+				// Center is inside, push out along the axis of least penetration
+				const float left   = p.x - b.min.x;
+				const float right  = b.max.x - p.x;
+				const float top    = p.y - b.min.y;
+				const float bottom = b.max.y - p.y;
+				const float least  = min(min(left, right), min(top, bottom));
+				normal = least == left  ? Vector2{ -1,  0 } :
+						 least == right ? Vector2{  1,  0 } :
+						 least == top   ? Vector2{  0, -1 } : Vector2{ 0, 1 };
+			}
+
+			toi = 0.0f;
+			return dot(delta, normal) < 0.0f;
+		}
+
+		// Ray against bounds expanded by radius
+		const Bounds e{ { b.min.x - r, b.min.y - r }, { b.max.x + r, b.max.y + r } };
+		float t_enter = 0.0f;
+		float t_exit  = 1.0f;
+		Vector2 enter_normal{};
+
+		const float p_axis[2]{ p.x, p.y };
+		const float d_axis[2]{ delta.x, delta.y };
+		const float min_axis[2]{ e.min.x, e.min.y };
+		const float max_axis[2]{ e.max.x, e.max.y };
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			if (d_axis[axis] == 0.0f)
+			{
+				if (p_axis[axis] < min_axis[axis] || p_axis[axis] > max_axis[axis])
+				{
+					return false;
+				}
+				continue;
+			}
+
+			float t0 = (min_axis[axis] - p_axis[axis]) / d_axis[axis];
+			float t1 = (max_axis[axis] - p_axis[axis]) / d_axis[axis];
+			float n  = -1.0f;
+			if (t0 > t1)
+			{
+				const float tmp = t0;
+				t0 = t1;
+				t1 = tmp;
+				n  = 1.0f;
+			}
+
+			if (t0 > t_enter)
+			{
+				t_enter = t0;
+				enter_normal = axis == 0 ? Vector2{ n, 0 } : Vector2{ 0, n };
+			}
+			t_exit = min(t_exit, t1);
+			if (t_enter > t_exit)
+			{
+				return false;
+			}
+		}
+
+		// Entry point in a corner region of the expanded bounds is only a hit if it touches the rounded corner
+		const Vector2 hit{ p + delta * t_enter };
+		const bool outside_x = hit.x < b.min.x || hit.x > b.max.x;
+		const bool outside_y = hit.y < b.min.y || hit.y > b.max.y;
+		if (outside_x && outside_y)
+		{
+			const Vector2 corner{ hit.x < b.min.x ? b.min.x : b.max.x, hit.y < b.min.y ? b.min.y : b.max.y };
+			float t = 0.0f;
+			if (!ray_circle(p, delta, corner, r, t_enter, t))
+			{
+				return false;
+			}
+
+			toi    = t;
+			normal = (p + delta * t - corner) / r;
+			return true;
+		}
+
+		toi    = t_enter;
+		normal = enter_normal;
+		return true;
+	}
+
 	constexpr bool has_intersection(const Circle& c, const Bounds& b)
 	{
 		const float dx = max(b.min.x, min(c.position.x, b.max.x)) - c.position.x;
@@ -161,4 +347,55 @@ namespace fmath
 		return has_intersection(rect_to_bounds(r1), rect_to_bounds(r2));
 	}
 
+	// Index of the lowest set bit, mask must not be zero
+	inline uint32_t lowest_bit(uint32_t mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctz(mask);
+#endif
+	}
+
+	// Lanes tested by one has_intersection_batch call
+#if defined(FMATH_AVX)
+	constexpr size_t batch_width = 8;
+#else
+	constexpr size_t batch_width = 4;
+#endif
+	constexpr size_t batch_alignment = batch_width * sizeof(float);
+
+	// Circle against batch_width bounds stored as separate arrays aligned to batch_alignment.
+	// Bit i of the result is set when the circle touches bounds i.
+	inline uint32_t has_intersection_batch(const Circle& c, const float* min_x, const float* min_y, const float* max_x, const float* max_y)
+	{
+#if defined(FMATH_AVX)
+		const __m256 cx = _mm256_set1_ps(c.position.x);
+		const __m256 cy = _mm256_set1_ps(c.position.y);
+		const __m256 r2 = _mm256_set1_ps(c.radius * c.radius);
+		const __m256 dx = _mm256_sub_ps(_mm256_max_ps(_mm256_load_ps(min_x), _mm256_min_ps(cx, _mm256_load_ps(max_x))), cx);
+		const __m256 dy = _mm256_sub_ps(_mm256_max_ps(_mm256_load_ps(min_y), _mm256_min_ps(cy, _mm256_load_ps(max_y))), cy);
+		const __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		return (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LE_OQ));
+#elif defined(FMATH_SSE)
+		const __m128 cx = _mm_set1_ps(c.position.x);
+		const __m128 cy = _mm_set1_ps(c.position.y);
+		const __m128 r2 = _mm_set1_ps(c.radius * c.radius);
+		const __m128 dx = _mm_sub_ps(_mm_max_ps(_mm_load_ps(min_x), _mm_min_ps(cx, _mm_load_ps(max_x))), cx);
+		const __m128 dy = _mm_sub_ps(_mm_max_ps(_mm_load_ps(min_y), _mm_min_ps(cy, _mm_load_ps(max_y))), cy);
+		const __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(d2, r2));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < batch_width; ++i)
+		{
+			const Bounds b{ { min_x[i], min_y[i] }, { max_x[i], max_y[i] } };
+			mask |= (uint32_t)has_intersection(c, b) << i;
+		}
+		return mask;
+#endif
+	}
+
 }
\ No newline at end of file
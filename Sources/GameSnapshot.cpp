@@ -0,0 +1,50 @@
+#include "GameSnapshot.h"
+
+#include <stdio.h>
+
+bool GameSnapshot::empty() const
+{
+	return data.empty();
+}
+
+void GameSnapshot::clear()
+{
+	data.clear();
+}
+
+bool GameSnapshot::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	const bool written = data.empty() || fwrite(data.data(), data.size(), 1, file) == 1;
+	return fclose(file) == 0 && written;
+}
+
+bool GameSnapshot::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	data.clear();
+	uint8_t buffer[4096];
+	size_t  read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + read);
+	}
+
+	const bool failed = ferror(file) != 0;
+	fclose(file);
+	if (failed)
+	{
+		data.clear();
+	}
+	return !failed;
+}
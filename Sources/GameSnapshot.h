@@ -0,0 +1,17 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Serialized registry and game state, written by Arcanoid::save_state.
+// Only meaningful to the build that wrote it, components are stored as raw bytes.
+struct GameSnapshot
+{
+	std::vector<uint8_t> data;
+
+	bool empty() const;
+	void clear();
+
+	bool save(const char* path) const;
+	bool load(const char* path);
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only std::function replacement that never allocates.
+// The callable is stored in place and has to fit into capacity bytes, checked at compile time.
+template<class signature, size_t capacity = 48>
+class InlineFunction;
+
+template<class r, class ... params, size_t capacity>
+class InlineFunction<r(params...), capacity> final
+{
+private:
+	using invoke_fn  = r(*)(void* storage, params&&... args);
+	using relocate_fn = void(*)(void* to, void* from);
+	using destroy_fn = void(*)(void* storage);
+
+	alignas(std::max_align_t) unsigned char m_storage[capacity];
+
+	invoke_fn   m_invoke{ nullptr };
+	relocate_fn m_relocate{ nullptr };
+	destroy_fn  m_destroy{ nullptr };
+
+	void reset()
+	{
+		if (m_destroy)
+		{
+			m_destroy(m_storage);
+		}
+		m_invoke   = nullptr;
+		m_relocate = nullptr;
+		m_destroy  = nullptr;
+	}
+
+	void take(InlineFunction& other)
+	{
+		if (other.m_invoke)
+		{
+			other.m_relocate(m_storage, other.m_storage);
+			m_invoke   = other.m_invoke;
+			m_relocate = other.m_relocate;
+			m_destroy  = other.m_destroy;
+			other.reset();
+		}
+	}
+
+public:
+	template<class fn, class = std::enable_if_t<!std::is_same_v<std::decay_t<fn>, InlineFunction>>>
+	InlineFunction(fn&& fun)
+	{
+		using stored = std::decay_t<fn>;
+		static_assert(sizeof(stored) <= capacity, "InlineFunction: callable doesn't fit, capture less or raise capacity");
+		static_assert(alignof(stored) <= alignof(std::max_align_t), "InlineFunction: callable is over-aligned");
+
+		new (m_storage) stored(std::forward<fn>(fun));
+		m_invoke = [](void* storage, params&&... args) -> r
+		{
+			return (*static_cast<stored*>(storage))(std::forward<params>(args)...);
+		};
+		m_relocate = [](void* to, void* from)
+		{
+			new (to) stored(std::move(*static_cast<stored*>(from)));
+		};
+		m_destroy = [](void* storage)
+		{
+			static_cast<stored*>(storage)->~stored();
+		};
+	}
+
+	InlineFunction(InlineFunction&& other)
+	{
+		take(other);
+	}
+
+	InlineFunction& operator=(InlineFunction&& other)
+	{
+		if (this != &other)
+		{
+			reset();
+			take(other);
+		}
+		return *this;
+	}
+
+	InlineFunction& operator=(std::nullptr_t)
+	{
+		reset();
+		return *this;
+	}
+
+	r operator()(params... args)
+	{
+		return m_invoke(m_storage, std::forward<params>(args)...);
+	}
+
+	explicit operator bool() const
+	{
+		return m_invoke != nullptr;
+	}
+
+	InlineFunction() = default;
+	InlineFunction(std::nullptr_t) {}
+	~InlineFunction()
+	{
+		reset();
+	}
+	InlineFunction(const InlineFunction&) = delete;
+	InlineFunction& operator=(const InlineFunction&) = delete;
+};
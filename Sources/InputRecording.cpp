@@ -0,0 +1,117 @@
+#include "InputRecording.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void InputRecording::push(InputMask mask)
+{
+	if (m_runs.empty() || m_runs.back().mask != mask || m_runs.back().length == UINT32_MAX)
+	{
+		m_runs.push_back({ 0, mask });
+	}
+	++m_runs.back().length;
+	++m_frame_count;
+}
+
+InputMask InputRecording::next()
+{
+	while (m_run < m_runs.size() && m_run_frame >= m_runs[m_run].length)
+	{
+		++m_run;
+		m_run_frame = 0;
+	}
+
+	if (m_run == m_runs.size())
+	{
+		return 0;
+	}
+
+	++m_run_frame;
+	++m_replayed;
+	return m_runs[m_run].mask;
+}
+
+bool InputRecording::is_finished() const
+{
+	return m_replayed >= m_frame_count;
+}
+
+uint64_t InputRecording::get_frame_count() const
+{
+	return m_frame_count;
+}
+
+bool InputRecording::save(const char* path) const
+{
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	InputRecordingHeader header{};
+	memcpy(header.magic, g_input_recording_magic, sizeof(header.magic));
+	header.version     = g_input_recording_version;
+	header.flags       = flags;
+	header.seed        = seed;
+	header.frame_count = m_frame_count;
+	header.run_count   = m_runs.size();
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+	for (const Run& run : m_runs)
+	{
+		written = written && fwrite(&run.length, sizeof(run.length), 1, file) == 1;
+		written = written && fwrite(&run.mask, sizeof(run.mask), 1, file) == 1;
+	}
+
+	return fclose(file) == 0 && written;
+}
+
+bool InputRecording::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	InputRecordingHeader header{};
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| memcmp(header.magic, g_input_recording_magic, sizeof(header.magic)) != 0
+		|| header.version != g_input_recording_version)
+	{
+		fclose(file);
+		return false;
+	}
+
+	m_runs.clear();
+	m_frame_count = 0;
+
+	bool read = true;
+	for (uint64_t i = 0; read && i < header.run_count; ++i)
+	{
+		Run run{};
+		read = fread(&run.length, sizeof(run.length), 1, file) == 1 && fread(&run.mask, sizeof(run.mask), 1, file) == 1;
+		if (read)
+		{
+			m_runs.push_back(run);
+			m_frame_count += run.length;
+		}
+	}
+	fclose(file);
+
+	// A truncated file would replay a different run
+	if (!read || m_frame_count != header.frame_count)
+	{
+		m_runs.clear();
+		m_frame_count = 0;
+		return false;
+	}
+
+	seed        = header.seed;
+	flags       = header.flags;
+	m_run       = 0;
+	m_run_frame = 0;
+	m_replayed  = 0;
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Keys held during one fixed frame, bit (1 << EInputEvent)
+using InputMask = uint8_t;
+
+// Header, then runs of equal input masks:
+// uint32 frame count and the mask, packed without padding
+constexpr char     g_input_recording_magic[8]{ 'L', 'A', 'R', 'C', 'R', 'E', 'C', 0 };
+constexpr uint32_t g_input_recording_version{ 1 };
+
+struct InputRecordingHeader
+{
+	char     magic[8];
+	uint32_t version;
+
+	// Game defined, see main.cpp
+	uint32_t flags;
+	uint64_t seed;
+	uint64_t frame_count;
+	uint64_t run_count;
+};
+
+// Input of every fixed frame of a run and the seed its randomness came from.
+// With the same build, feeding it back frame by frame reproduces the run exactly.
+class InputRecording final
+{
+private:
+	struct Run
+	{
+		uint32_t  length;
+		InputMask mask;
+	};
+
+	std::vector<Run> m_runs;
+	uint64_t         m_frame_count{ 0 };
+
+	// Replay cursor
+	size_t           m_run{ 0 };
+	uint32_t         m_run_frame{ 0 };
+	uint64_t         m_replayed{ 0 };
+
+public:
+	uint64_t seed{ 0 };
+	uint32_t flags{ 0 };
+
+	void push(InputMask mask);
+
+	// Masks in recorded order, zero past the end
+	InputMask next();
+	bool      is_finished() const;
+
+	uint64_t  get_frame_count() const;
+
+	bool save(const char* path) const;
+	bool load(const char* path);
+};
@@ -0,0 +1,179 @@
+#include "Level.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Same order as EBlockColor
+static constexpr const char* c_color_names[]{ "cyan", "green", "purple", "red", "yellow" };
+
+// Far beyond any playable level, keeps a typo from reserving memory for billions of blocks
+static constexpr int c_max_grid_blocks{ 1 << 16 };
+
+static bool parse_color(const char* name, uint8_t& color)
+{
+	if (strcmp(name, "random") == 0)
+	{
+		color = g_level_random_color;
+		return true;
+	}
+
+	for (uint8_t i = 0; i < sizeof(c_color_names) / sizeof(c_color_names[0]); ++i)
+	{
+		if (strcmp(name, c_color_names[i]) == 0)
+		{
+			color = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Level::load(const void* data, size_t size)
+{
+	if (size >= sizeof(g_level_magic) && memcmp(data, g_level_magic, sizeof(g_level_magic)) == 0)
+	{
+		return read_binary(data, size);
+	}
+	return parse_text(static_cast<const char*>(data), size);
+}
+
+bool Level::load(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	uint8_t buffer[4096];
+	size_t  read = 0;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + read);
+	}
+
+	const bool failed = ferror(file) != 0;
+	fclose(file);
+	return !failed && load(data.data(), data.size());
+}
+
+void Level::add_grid(Vector2 offset, uint32_t columns, uint32_t rows, Vector2 dimensions, Vector2 gap, float life, uint8_t color)
+{
+	blocks.reserve(blocks.size() + (size_t)columns * rows);
+	for (uint32_t i = 0; i < columns; ++i)
+	{
+		for (uint32_t j = 0; j < rows; ++j)
+		{
+			const Vector2 position{ dimensions / 2 + offset + (dimensions + gap) * Vector2{ (float)i, (float)j } };
+			blocks.push_back({ position, dimensions, life, color });
+		}
+	}
+}
+
+bool Level::parse_text(const char* text, size_t size)
+{
+	blocks.clear();
+
+	std::string line;
+	uint32_t    line_number = 0;
+	for (size_t begin = 0; begin < size;)
+	{
+		const char*  end    = static_cast<const char*>(memchr(text + begin, '\n', size - begin));
+		const size_t length = end ? (size_t)(end - (text + begin)) : size - begin;
+		line.assign(text + begin, length);
+		begin += length + 1;
+		++line_number;
+
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.resize(comment);
+		}
+
+		char command[16]{};
+		int  consumed = 0;
+		if (sscanf(line.c_str(), "%15s%n", command, &consumed) != 1)
+		{
+			continue;
+		}
+
+		const char* args = line.c_str() + consumed;
+		char        color_name[16]{ "random" };
+		uint8_t     color = g_level_random_color;
+		bool        valid = false;
+
+		if (strcmp(command, "grid") == 0)
+		{
+			Vector2 offset, dimensions, gap;
+			int     columns = 0, rows = 0;
+			float   life = 0;
+			// Signed, %u would take -1 as 4294967295 columns
+			valid = sscanf(args, "%f %f %d %d %f %f %f %f %f %15s", &offset.x, &offset.y, &columns, &rows,
+				&dimensions.x, &dimensions.y, &gap.x, &gap.y, &life, color_name) >= 9 && parse_color(color_name, color)
+				&& columns > 0 && rows > 0 && columns <= c_max_grid_blocks / rows;
+			if (valid)
+			{
+				add_grid(offset, (uint32_t)columns, (uint32_t)rows, dimensions, gap, life, color);
+			}
+		}
+		else if (strcmp(command, "block") == 0)
+		{
+			Vector2 position, dimensions;
+			float   life = 0;
+			valid = sscanf(args, "%f %f %f %f %f %15s", &position.x, &position.y,
+				&dimensions.x, &dimensions.y, &life, color_name) >= 5 && parse_color(color_name, color);
+			if (valid)
+			{
+				blocks.push_back({ position + dimensions / 2, dimensions, life, color });
+			}
+		}
+
+		if (!valid)
+		{
+			SDL_Log("Level line %u can't be parsed: %s", line_number, line.c_str());
+			blocks.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Level::read_binary(const void* data, size_t size)
+{
+	blocks.clear();
+
+	LevelHeader header{};
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, g_level_magic, sizeof(header.magic)) != 0
+		|| header.version != g_level_version
+		|| (size - sizeof(header)) / sizeof(LevelBlock) < header.block_count)
+	{
+		return false;
+	}
+
+	blocks.resize(header.block_count);
+	memcpy(blocks.data(), static_cast<const uint8_t*>(data) + sizeof(header), blocks.size() * sizeof(LevelBlock));
+	return true;
+}
+
+void Level::write_binary(std::vector<uint8_t>& data) const
+{
+	LevelHeader header{};
+	memcpy(header.magic, g_level_magic, sizeof(header.magic));
+	header.version     = g_level_version;
+	header.block_count = (uint32_t)blocks.size();
+
+	const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+	const uint8_t* block_bytes  = reinterpret_cast<const uint8_t*>(blocks.data());
+	data.assign(header_bytes, header_bytes + sizeof(header));
+	data.insert(data.end(), block_bytes, block_bytes + blocks.size() * sizeof(LevelBlock));
+}
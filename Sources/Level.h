@@ -0,0 +1,54 @@
+#pragma once
+#include "FMath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Blocks are authored as text, one command per line, '#' starts a comment.
+// Units are unscaled game units from the top left corner of the game area:
+//
+//   grid  <x> <y> <columns> <rows> <width> <height> <gap x> <gap y> <life> [color]
+//   block <x> <y> <width> <height> <life> [color]
+//
+// Colors are cyan, green, purple, red, yellow or random, random when left out.
+// larcanoid_pack compiles levels to the binary form: the header, then every block as it is in memory.
+constexpr char     g_level_magic[8]{ 'L', 'A', 'R', 'C', 'L', 'V', 'L', 0 };
+constexpr uint32_t g_level_version{ 1 };
+
+// Index into EBlockColor, anything past it picks a color with the game's random engine
+constexpr uint8_t  g_level_random_color{ 0xff };
+
+struct LevelHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t block_count;
+};
+
+struct LevelBlock
+{
+	// Center
+	Vector2 position;
+	Vector2 dimensions;
+	float   life;
+	uint8_t color;
+	uint8_t padding[3]{};
+};
+
+// Grids are expanded on load, so the binary form is just the blocks
+struct Level
+{
+	std::vector<LevelBlock> blocks;
+
+	// Either form, told apart by the magic
+	bool load(const void* data, size_t size);
+	bool load(const char* path);
+
+	// Column by column, the order random colors are picked in
+	void add_grid(Vector2 offset, uint32_t columns, uint32_t rows, Vector2 dimensions, Vector2 gap, float life, uint8_t color);
+
+	bool parse_text(const char* text, size_t size);
+	bool read_binary(const void* data, size_t size);
+	void write_binary(std::vector<uint8_t>& data) const;
+};
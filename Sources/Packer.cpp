@@ -0,0 +1,236 @@
+#include "AssetArchive.h"
+#include "Config.h"
+#include "Level.h"
+
+// Plain command line tool, no SDL2main
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <SDL_image.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Usage: larcanoid_pack <resources directory> <archive>
+// Decodes every PNG to RGBA32 and every WAV to the PCM format the game opens the mixer with,
+// music and fonts are stored as they are, they are streamed and parsed by SDL_mixer and SDL_ttf.
+// Levels are compiled to their binary form under the same name, the game tells the forms apart by the magic.
+
+namespace fs = std::filesystem;
+
+struct PackedAsset
+{
+	AssetEntry           entry{};
+	std::vector<uint8_t> data;
+};
+
+static bool pack_image(const fs::path& path, PackedAsset& asset)
+{
+	SDL_Surface* loaded = IMG_Load(path.string().c_str());
+	if (loaded == nullptr)
+	{
+		return false;
+	}
+
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(loaded);
+	if (rgba == nullptr)
+	{
+		return false;
+	}
+
+	asset.entry.type      = EAssetType::image;
+	asset.entry.params[0] = (uint32_t)rgba->w;
+	asset.entry.params[1] = (uint32_t)rgba->h;
+	asset.entry.params[2] = (uint32_t)rgba->pitch;
+
+	const uint8_t* pixels = static_cast<const uint8_t*>(rgba->pixels);
+	asset.data.assign(pixels, pixels + (size_t)rgba->pitch * rgba->h);
+	SDL_FreeSurface(rgba);
+	return true;
+}
+
+static bool pack_sound(const fs::path& path, PackedAsset& asset)
+{
+	SDL_AudioSpec spec{};
+	Uint8*        samples{ nullptr };
+	Uint32        length{ 0 };
+	if (SDL_LoadWAV(path.string().c_str(), &spec, &samples, &length) == nullptr)
+	{
+		return false;
+	}
+
+	SDL_AudioCVT cvt{};
+	if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_S16SYS, (Uint8)g_audio_channels, g_audio_frequency) < 0)
+	{
+		SDL_FreeWAV(samples);
+		return false;
+	}
+
+	std::vector<uint8_t> buffer((size_t)length * cvt.len_mult);
+	memcpy(buffer.data(), samples, length);
+	SDL_FreeWAV(samples);
+
+	cvt.len = (int)length;
+	cvt.buf = buffer.data();
+	if (SDL_ConvertAudio(&cvt) < 0)
+	{
+		return false;
+	}
+	buffer.resize((size_t)cvt.len_cvt);
+
+	asset.entry.type      = EAssetType::sound;
+	asset.entry.params[0] = (uint32_t)g_audio_frequency;
+	asset.entry.params[1] = (uint32_t)AUDIO_S16SYS;
+	asset.entry.params[2] = (uint32_t)g_audio_channels;
+	asset.data            = std::move(buffer);
+	return true;
+}
+
+static bool pack_blob(const fs::path& path, PackedAsset& asset)
+{
+	FILE* file = fopen(path.string().c_str(), "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	asset.entry.type = EAssetType::blob;
+	asset.data.resize((size_t)fs::file_size(path));
+	const size_t read = fread(asset.data.data(), 1, asset.data.size(), file);
+	fclose(file);
+	return read == asset.data.size();
+}
+
+static bool pack_level(const fs::path& path, PackedAsset& asset)
+{
+	Level level;
+	if (!level.load(path.string().c_str()))
+	{
+		SDL_SetError("Level can't be parsed");
+		return false;
+	}
+
+	asset.entry.type = EAssetType::blob;
+	level.write_binary(asset.data);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s <resources directory> <archive>\n", argv[0]);
+		return 1;
+	}
+
+	SDL_SetMainReady();
+
+	const fs::path root{ argv[1] };
+
+	// Sorted, the reader finds entries with a binary search
+	std::vector<fs::path> paths;
+	for (const fs::directory_entry& file : fs::recursive_directory_iterator(root))
+	{
+		if (file.is_regular_file())
+		{
+			paths.push_back(file.path());
+		}
+	}
+	std::sort(paths.begin(), paths.end(), [&](const fs::path& first, const fs::path& second)
+	{
+		return fs::relative(first, root).generic_string() < fs::relative(second, root).generic_string();
+	});
+
+	std::vector<PackedAsset> assets;
+	for (const fs::path& path : paths)
+	{
+		const std::string name{ fs::relative(path, root).generic_string() };
+		if (name.size() >= sizeof(AssetEntry::name))
+		{
+			fprintf(stderr, "Skipping %s, name is too long\n", name.c_str());
+			continue;
+		}
+
+		PackedAsset asset;
+		strncpy(asset.entry.name, name.c_str(), sizeof(asset.entry.name) - 1);
+
+		// Music is streamed by SDL_mixer, decoding it would only make it larger
+		const std::string extension{ path.extension().string() };
+		bool packed = false;
+		if (extension == ".png")
+		{
+			packed = pack_image(path, asset);
+		}
+		else if (extension == ".wav" && path.stem() != "music")
+		{
+			packed = pack_sound(path, asset);
+		}
+		else if (extension == ".lvl")
+		{
+			packed = pack_level(path, asset);
+		}
+		else
+		{
+			packed = pack_blob(path, asset);
+		}
+
+		if (!packed)
+		{
+			fprintf(stderr, "Failed to pack %s: %s\n", name.c_str(), SDL_GetError());
+			return 1;
+		}
+
+		assets.push_back(std::move(asset));
+	}
+
+	// Layout data after the index
+	uint64_t offset = sizeof(AssetArchiveHeader) + assets.size() * sizeof(AssetEntry);
+	for (PackedAsset& asset : assets)
+	{
+		offset = (offset + g_asset_data_alignment - 1) / g_asset_data_alignment * g_asset_data_alignment;
+		asset.entry.offset = offset;
+		asset.entry.size   = asset.data.size();
+		offset += asset.data.size();
+	}
+
+	FILE* archive = fopen(argv[2], "wb");
+	if (archive == nullptr)
+	{
+		fprintf(stderr, "Can't write %s\n", argv[2]);
+		return 1;
+	}
+
+	AssetArchiveHeader header{};
+	memcpy(header.magic, g_asset_archive_magic, sizeof(header.magic));
+	header.version     = g_asset_archive_version;
+	header.entry_count = (uint32_t)assets.size();
+	fwrite(&header, sizeof(header), 1, archive);
+
+	for (const PackedAsset& asset : assets)
+	{
+		fwrite(&asset.entry, sizeof(asset.entry), 1, archive);
+	}
+
+	uint64_t position = sizeof(AssetArchiveHeader) + assets.size() * sizeof(AssetEntry);
+	const uint8_t padding[g_asset_data_alignment]{};
+	for (const PackedAsset& asset : assets)
+	{
+		fwrite(padding, 1, (size_t)(asset.entry.offset - position), archive);
+		fwrite(asset.data.data(), 1, asset.data.size(), archive);
+		position = asset.entry.offset + asset.entry.size;
+	}
+
+	const bool written = ferror(archive) == 0;
+	fclose(archive);
+	if (!written)
+	{
+		fprintf(stderr, "Failed writing %s\n", argv[2]);
+		return 1;
+	}
+
+	printf("Packed %zu assets into %s, %llu bytes\n", assets.size(), argv[2], (unsigned long long)position);
+	return 0;
+}
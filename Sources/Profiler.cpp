@@ -0,0 +1,151 @@
+#include "Profiler.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <algorithm>
+
+// Weight of the current frame in the rolling averages
+static constexpr double c_average_weight = 0.05;
+
+static thread_local void* t_ring = nullptr;
+
+Profiler& Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+uint64_t Profiler::now()
+{
+	return SDL_GetPerformanceCounter();
+}
+
+Profiler::Ring& Profiler::get_ring()
+{
+	if (t_ring == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(m_rings_mutex);
+		m_rings.push_back(std::make_unique<Ring>());
+		m_rings.back()->thread_id = (uint32_t)(m_rings.size() - 1);
+		t_ring = m_rings.back().get();
+	}
+	return *static_cast<Ring*>(t_ring);
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+	Ring& ring = get_ring();
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	ring.events[head & (Ring::c_capacity - 1)] = { name, begin, end };
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::add_to_stats(const ProfileEvent& event)
+{
+	auto it = std::lower_bound(m_stats.begin(), m_stats.end(), event.name, [](const Stat& stat, const char* name)
+	{
+		return std::less<const char*>{}(stat.name, name);
+	});
+	if (it == m_stats.end() || it->name != event.name)
+	{
+		it = m_stats.insert(it, { event.name, 0, 0, 0.0 });
+	}
+	it->frame_ticks += event.end - event.begin;
+	it->total_ticks += event.end - event.begin;
+}
+
+void Profiler::end_frame()
+{
+	std::lock_guard<std::mutex> lock(m_rings_mutex);
+	for (auto& ring : m_rings)
+	{
+		const uint64_t head  = ring->head.load(std::memory_order_acquire);
+		const uint64_t first = std::max(ring->read, head >= Ring::c_capacity ? head - Ring::c_capacity + 1 : 0);
+
+		m_scratch.clear();
+		for (uint64_t i = first; i < head; ++i)
+		{
+			m_scratch.push_back(ring->events[i & (Ring::c_capacity - 1)]);
+		}
+
+		// Everything the writer lapped during the copy is garbage, including the slot of the
+		// event it may be writing right now, which is one past the published head
+		const uint64_t after = ring->head.load(std::memory_order_acquire);
+		const uint64_t valid = after >= Ring::c_capacity ? after - Ring::c_capacity + 1 : 0;
+		const size_t   skip  = valid > first ? (size_t)std::min<uint64_t>(valid - first, m_scratch.size()) : 0;
+
+		for (size_t i = skip; i < m_scratch.size(); ++i)
+		{
+			add_to_stats(m_scratch[i]);
+			if (m_capture)
+			{
+				m_trace.push_back({ m_scratch[i], ring->thread_id });
+			}
+		}
+		ring->read = head;
+	}
+
+	for (Stat& stat : m_stats)
+	{
+		const double frame_ms = stat.frame_ticks * m_ms_per_tick;
+		stat.average_ms  = stat.average_ms + (frame_ms - stat.average_ms) * c_average_weight;
+		stat.frame_ticks = 0;
+	}
+}
+
+void Profiler::get_stats(std::vector<ProfileStat>& stats) const
+{
+	stats.clear();
+	for (const Stat& stat : m_stats)
+	{
+		stats.push_back({ stat.name, stat.average_ms, stat.total_ticks * m_ms_per_tick });
+	}
+}
+
+void Profiler::reset_totals()
+{
+	for (Stat& stat : m_stats)
+	{
+		stat.total_ticks = 0;
+	}
+}
+
+void Profiler::set_capture(bool capture)
+{
+	m_capture = capture;
+}
+
+bool Profiler::write_chrome_trace(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	// Complete events ("ph":"X"), timestamps and durations in microseconds
+	const double us_per_tick = m_ms_per_tick * 1000.0;
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < m_trace.size(); ++i)
+	{
+		const TraceEvent& trace = m_trace[i];
+		fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+			trace.event.name, trace.thread_id,
+			(int64_t)(trace.event.begin - m_origin) * us_per_tick,
+			(trace.event.end - trace.event.begin) * us_per_tick,
+			i + 1 < m_trace.size() ? "," : "");
+	}
+	fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	return fclose(file) == 0;
+}
+
+Profiler::Profiler()
+{
+	m_origin      = now();
+	m_ms_per_tick = 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+Profiler::~Profiler()
+{
+}
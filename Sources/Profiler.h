@@ -0,0 +1,125 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Scoped timing zones, enabled with the LARCANOID_PROFILE CMake option.
+// Without it PROFILE_ZONE and PROFILE_FRAME expand to nothing.
+#if LARCANOID_PROFILE
+	#define PROFILE_CONCAT_INNER(a, b) a##b
+	#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+	#define PROFILE_ZONE(name) const ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+	#define PROFILE_FRAME() Profiler::get().end_frame()
+	constexpr bool g_profile_enabled = true;
+#else
+	#define PROFILE_ZONE(name) ((void)0)
+	#define PROFILE_FRAME() ((void)0)
+	constexpr bool g_profile_enabled = false;
+#endif
+
+// Names are string literals, they are compared by address
+struct ProfileEvent
+{
+	const char* name;
+	uint64_t    begin;
+	uint64_t    end;
+};
+
+struct ProfileStat
+{
+	const char* name;
+	double      average_ms;
+
+	// Since reset_totals
+	double      total_ms;
+};
+
+class Profiler final
+{
+private:
+	// Written by its thread only, read by whoever calls end_frame.
+	// Readers drop events the writer may have overwritten while they were copied.
+	struct Ring
+	{
+		static constexpr size_t c_capacity = 1 << 14;
+
+		ProfileEvent          events[c_capacity];
+		std::atomic<uint64_t> head{ 0 };
+		uint64_t              read{ 0 };
+		uint32_t              thread_id{ 0 };
+	};
+
+	struct TraceEvent
+	{
+		ProfileEvent event;
+		uint32_t     thread_id;
+	};
+
+	struct Stat
+	{
+		const char* name;
+		uint64_t    frame_ticks;
+		uint64_t    total_ticks;
+		double      average_ms;
+	};
+
+	// Rings outlive their threads, a worker may exit before the last end_frame
+	std::mutex                         m_rings_mutex;
+	std::vector<std::unique_ptr<Ring>> m_rings;
+
+	std::vector<ProfileEvent> m_scratch;
+	std::vector<Stat>         m_stats;
+
+	bool                    m_capture{ false };
+	std::vector<TraceEvent> m_trace;
+
+	uint64_t m_origin{ 0 };
+	double   m_ms_per_tick{ 0.0 };
+
+	Ring& get_ring();
+	void  add_to_stats(const ProfileEvent& event);
+
+public:
+	static Profiler& get();
+	static uint64_t now();
+
+	// Lock free apart from the first event of a thread
+	void record(const char* name, uint64_t begin, uint64_t end);
+
+	// Collects the events of all threads and updates rolling averages, once per frame from one thread
+	void end_frame();
+
+	// Same thread as end_frame, ordered by name address
+	void get_stats(std::vector<ProfileStat>& stats) const;
+	void reset_totals();
+
+	// Keeps every collected event until write_chrome_trace
+	void set_capture(bool capture);
+	bool write_chrome_trace(const char* path) const;
+
+	Profiler();
+	~Profiler();
+	Profiler(Profiler&) = delete;
+};
+
+class ProfileZone final
+{
+private:
+	const char* m_name;
+	uint64_t    m_begin;
+
+public:
+	explicit ProfileZone(const char* name) : m_name(name), m_begin(Profiler::now())
+	{
+	}
+
+	~ProfileZone()
+	{
+		Profiler::get().record(m_name, m_begin, Profiler::now());
+	}
+
+	ProfileZone(ProfileZone&) = delete;
+};
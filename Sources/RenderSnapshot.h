@@ -0,0 +1,99 @@
+#pragma once
+#include "FMath.h"
+#include "TextureAtlas.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+struct SnapshotSprite
+{
+	TextureRegion region;
+	Rect          rect;
+	float         alpha;
+};
+
+struct SnapshotText
+{
+	Bounds      target;
+	std::string text;
+};
+
+// What an actor draws in one frame, copied out of the simulation so another thread can draw it.
+// Buffers and strings keep their capacity between frames.
+struct RenderSnapshot
+{
+	std::vector<SnapshotSprite> sprites;
+	std::vector<SnapshotText>   texts;
+	size_t                      text_count{ 0 };
+
+	void clear()
+	{
+		sprites.clear();
+		text_count = 0;
+	}
+
+	void add_sprite(const TextureRegion& region, const Rect& rect, float alpha)
+	{
+		sprites.push_back({ region, rect, alpha });
+	}
+
+	void add_text(const Bounds& target, const char* text)
+	{
+		if (text_count == texts.size())
+		{
+			texts.emplace_back();
+		}
+		texts[text_count].target = target;
+		texts[text_count].text.assign(text);
+		++text_count;
+	}
+};
+
+// One writer and one reader that never wait for each other.
+// Writer fills get_back() and publishes it, reader acquires the latest published buffer,
+// frames published in between are skipped and a buffer is never read while written.
+template<class t>
+class TripleBuffer final
+{
+private:
+	static constexpr uint8_t c_index_mask = 3;
+	static constexpr uint8_t c_fresh      = 4;
+
+	t m_buffers[3];
+
+	// Index of the buffer between writer and reader, c_fresh while unread
+	std::atomic<uint8_t> m_middle{ 1 };
+	uint8_t m_back{ 0 };
+	uint8_t m_front{ 2 };
+
+public:
+	t& get_back()
+	{
+		return m_buffers[m_back];
+	}
+
+	void publish()
+	{
+		m_back = m_middle.exchange(m_back | c_fresh, std::memory_order_acq_rel) & c_index_mask;
+	}
+
+	// False when nothing was published since the last acquire
+	bool acquire()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & c_fresh) == 0)
+		{
+			return false;
+		}
+
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & c_index_mask;
+		return true;
+	}
+
+	const t& get_front() const
+	{
+		return m_buffers[m_front];
+	}
+};
@@ -0,0 +1,91 @@
+#include "SpriteBatch.h"
+
+#include <SDL.h>
+#include <algorithm>
+
+void SpriteBatch::add(const TextureRegion& region, const Rect& rect, float alpha)
+{
+	m_sprites.push_back({ region.texture, fmath::rect_to_bounds(rect), region.uv, (uint8_t)(fmath::clamp(alpha, 0.0f, 1.0f) * 255) });
+}
+
+void SpriteBatch::clear()
+{
+	m_sprites.clear();
+}
+
+void SpriteBatch::flush(SDL_Renderer* renderer)
+{
+	m_submissions = 0;
+	if (m_sprites.empty())
+	{
+		return;
+	}
+
+	// Stable, so sprites sharing a texture keep their relative draw order
+	std::stable_sort(m_sprites.begin(), m_sprites.end(), [](const SpriteInstance& first, const SpriteInstance& second)
+	{
+		if (first.texture != second.texture)
+		{
+			return first.texture < second.texture;
+		}
+		return first.alpha < second.alpha;
+	});
+
+	// Same two triangles for every quad, runs index relative to their first vertex
+	const size_t quads = m_sprites.size();
+	for (size_t i = m_indices.size() / 6; i < quads; ++i)
+	{
+		const int v = (int)i * 4;
+		m_indices.insert(m_indices.end(), { v, v + 1, v + 2, v + 2, v + 3, v });
+	}
+
+	m_vertices.resize(quads * 4);
+	for (size_t i = 0; i < quads; ++i)
+	{
+		const SpriteInstance& sprite = m_sprites[i];
+
+		// Untextured sprites are drawn as light grey rectangles
+		const SDL_Color color = sprite.texture != nullptr ? SDL_Color{ 255, 255, 255, sprite.alpha } : SDL_Color{ 244, 244, 244, sprite.alpha };
+		const Bounds& s  = sprite.screen;
+		const Bounds& uv = sprite.uv;
+
+		SDL_Vertex* v = &m_vertices[i * 4];
+		v[0] = { { s.min.x, s.min.y }, color, { uv.min.x, uv.min.y } };
+		v[1] = { { s.max.x, s.min.y }, color, { uv.max.x, uv.min.y } };
+		v[2] = { { s.max.x, s.max.y }, color, { uv.max.x, uv.max.y } };
+		v[3] = { { s.min.x, s.max.y }, color, { uv.min.x, uv.max.y } };
+	}
+
+	// Alpha lives in vertex colors, so a run only breaks on texture change
+	size_t run_start = 0;
+	for (size_t i = 1; i <= quads; ++i)
+	{
+		if (i == quads || m_sprites[i].texture != m_sprites[run_start].texture)
+		{
+			const int run_quads = (int)(i - run_start);
+			SDL_RenderGeometry(renderer, m_sprites[run_start].texture, &m_vertices[run_start * 4], run_quads * 4, m_indices.data(), run_quads * 6);
+			++m_submissions;
+			run_start = i;
+		}
+	}
+
+	m_sprites.clear();
+}
+
+size_t SpriteBatch::size() const
+{
+	return m_sprites.size();
+}
+
+uint32_t SpriteBatch::get_submission_count() const
+{
+	return m_submissions;
+}
+
+SpriteBatch::SpriteBatch()
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+}
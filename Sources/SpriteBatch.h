@@ -0,0 +1,46 @@
+#pragma once
+#include "FMath.h"
+#include "TextureAtlas.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct SDL_Renderer;
+struct SDL_Texture;
+struct SDL_Vertex;
+
+struct SpriteInstance
+{
+	SDL_Texture* texture{ nullptr };
+	Bounds       screen{};
+	Bounds       uv{};
+	uint8_t      alpha{ 255 };
+};
+
+// Collects sprites for a frame and submits them grouped by texture,
+// one SDL_RenderGeometry call per run instead of one SDL_RenderCopy per sprite.
+// Buffers are kept between frames, so a steady scene doesn't allocate.
+class SpriteBatch final
+{
+private:
+	std::vector<SpriteInstance> m_sprites;
+	std::vector<SDL_Vertex>     m_vertices;
+	std::vector<int>            m_indices;
+
+	// Draw calls issued by the last flush
+	uint32_t m_submissions{ 0 };
+
+public:
+	void add(const TextureRegion& region, const Rect& rect, float alpha);
+	void clear();
+
+	// Sorts by texture and alpha, submits and clears
+	void flush(SDL_Renderer* renderer);
+
+	size_t   size() const;
+	uint32_t get_submission_count() const;
+
+	SpriteBatch();
+	~SpriteBatch();
+	SpriteBatch(SpriteBatch&) = delete;
+};
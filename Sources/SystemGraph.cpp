@@ -0,0 +1,130 @@
+#include "SystemGraph.h"
+#include "Profiler.h"
+
+#include <assert.h>
+
+size_t allocate_access_bit()
+{
+	static std::atomic<size_t> next_bit{ 0 };
+	const size_t bit = next_bit++;
+	assert(bit < g_max_access_types && "Raise g_max_access_types");
+	return bit;
+}
+
+bool SystemAccess::conflicts(const SystemAccess& other) const
+{
+	if (structural || other.structural)
+	{
+		return true;
+	}
+
+	return (writes & (other.reads | other.writes)).any() || (other.writes & reads).any();
+}
+
+void SystemGraph::build()
+{
+	// Every system waits for all earlier systems it conflicts with
+	for (System& system : m_systems)
+	{
+		system.dependents.clear();
+		system.dependency_count = 0;
+	}
+
+	for (size_t i = 0; i < m_systems.size(); ++i)
+	{
+		for (size_t j = 0; j < i; ++j)
+		{
+			if (m_systems[i].access.conflicts(m_systems[j].access))
+			{
+				m_systems[j].dependents.push_back(i);
+				++m_systems[i].dependency_count;
+			}
+		}
+	}
+
+	m_remaining = std::make_unique<std::atomic<uint32_t>[]>(m_systems.size());
+	m_dirty = false;
+}
+
+void SystemGraph::run_system(ThreadPool& pool, TaskCounter& counter, size_t index)
+{
+	{
+		PROFILE_ZONE(m_systems[index].name);
+		m_systems[index].fun();
+	}
+
+	for (const size_t dependent : m_systems[index].dependents)
+	{
+		if (m_remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			pool.submit([this, &pool, &counter, dependent]() { run_system(pool, counter, dependent); }, counter);
+		}
+	}
+}
+
+size_t SystemGraph::add(const char* name, const SystemAccess& access, SystemFunction&& fun)
+{
+	System& system = m_systems.emplace_back();
+	system.name   = name;
+	system.access = access;
+	system.fun    = std::move(fun);
+	m_dirty = true;
+	return m_systems.size() - 1;
+}
+
+void SystemGraph::clear()
+{
+	m_systems.clear();
+	m_dirty = true;
+}
+
+void SystemGraph::run(ThreadPool& pool)
+{
+	if (m_dirty)
+	{
+		build();
+	}
+
+	for (size_t i = 0; i < m_systems.size(); ++i)
+	{
+		m_remaining[i].store(m_systems[i].dependency_count, std::memory_order_relaxed);
+	}
+
+	TaskCounter counter{ 0 };
+	for (size_t i = 0; i < m_systems.size(); ++i)
+	{
+		if (m_systems[i].dependency_count == 0)
+		{
+			pool.submit([this, &pool, &counter, i]() { run_system(pool, counter, i); }, counter);
+		}
+	}
+	pool.wait(counter);
+}
+
+// Registration order is a valid order of the graph
+void SystemGraph::run()
+{
+	for (System& system : m_systems)
+	{
+		PROFILE_ZONE(system.name);
+		system.fun();
+	}
+}
+
+size_t SystemGraph::size() const
+{
+	return m_systems.size();
+}
+
+const char* SystemGraph::get_name(size_t index) const
+{
+	return m_systems[index].name;
+}
+
+SystemGraph::SystemGraph()
+{
+}
+
+SystemGraph::~SystemGraph()
+{
+}
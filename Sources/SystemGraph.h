@@ -0,0 +1,97 @@
+#pragma once
+#include "InlineFunction.h"
+#include "ThreadPool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <vector>
+
+constexpr size_t g_max_access_types{ 64 };
+
+using AccessMask = std::bitset<g_max_access_types>;
+
+size_t allocate_access_bit();
+
+// One bit per type, handed out on first use. Works for components and for
+// tag types that stand for shared state outside the registry (audio, score, ...)
+template<class t>
+size_t get_access_bit()
+{
+	static const size_t bit = allocate_access_bit();
+	return bit;
+}
+
+struct SystemAccess
+{
+	AccessMask reads;
+	AccessMask writes;
+
+	// Creates or destroys entities, which touches every pool
+	bool structural{ false };
+
+	template<class ... types>
+	SystemAccess& read()
+	{
+		(reads.set(get_access_bit<types>()), ...);
+		return *this;
+	}
+
+	template<class ... types>
+	SystemAccess& write()
+	{
+		(writes.set(get_access_bit<types>()), ...);
+		return *this;
+	}
+
+	SystemAccess& structure()
+	{
+		structural = true;
+		return *this;
+	}
+
+	bool conflicts(const SystemAccess& other) const;
+};
+
+using SystemFunction = InlineFunction<void(), 48>;
+
+// Systems with conflicting access run in registration order, others run concurrently.
+// Results don't depend on thread count as long as access is declared honestly.
+class SystemGraph final
+{
+private:
+	struct System
+	{
+		const char*         name{ nullptr };
+		SystemAccess        access;
+		SystemFunction      fun;
+		std::vector<size_t> dependents;
+		uint32_t            dependency_count{ 0 };
+	};
+
+	std::vector<System> m_systems;
+
+	// Dependencies still running, per system, reset every run
+	std::unique_ptr<std::atomic<uint32_t>[]> m_remaining;
+
+	bool m_dirty{ true };
+
+	void build();
+	void run_system(ThreadPool& pool, TaskCounter& counter, size_t index);
+
+public:
+	size_t add(const char* name, const SystemAccess& access, SystemFunction&& fun);
+	void clear();
+
+	void run(ThreadPool& pool);
+	void run();
+
+	size_t size() const;
+	const char* get_name(size_t index) const;
+
+	SystemGraph();
+	~SystemGraph();
+	SystemGraph(SystemGraph&) = delete;
+};
@@ -0,0 +1,162 @@
+#include "TextRenderer.h"
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string.h>
+
+uint64_t TextRenderer::hash(const char* text)
+{
+	// FNV-1a
+	uint64_t result = 14695981039346656037ull;
+	for (const char* c = text; *c != '\0'; ++c)
+	{
+		result ^= (uint8_t)*c;
+		result *= 1099511628211ull;
+	}
+	return result;
+}
+
+const TextRenderer::Layout& TextRenderer::get_layout(const char* text)
+{
+	const uint64_t text_hash = hash(text);
+
+	auto it = m_lookup.find(text_hash);
+	if (it != m_lookup.end())
+	{
+		auto layout = it->second;
+		if (layout->text == text)
+		{
+			m_layouts.splice(m_layouts.begin(), m_layouts, layout);
+			return *layout;
+		}
+
+		// Hash collision, the new string takes the slot
+		m_lookup.erase(it);
+		m_layouts.splice(m_layouts.begin(), m_layouts, layout);
+	}
+	else if (m_layouts.size() < c_cache_size)
+	{
+		m_layouts.emplace_front();
+	}
+	else
+	{
+		// Reuse the least recently used entry and its buffers
+		m_lookup.erase(m_layouts.back().hash);
+		m_layouts.splice(m_layouts.begin(), m_layouts, std::prev(m_layouts.end()));
+	}
+
+	Layout& layout = m_layouts.front();
+	build_layout(layout, text_hash, text);
+	m_lookup[text_hash] = m_layouts.begin();
+	return layout;
+}
+
+void TextRenderer::build_layout(Layout& layout, uint64_t text_hash, const char* text)
+{
+	layout.hash = text_hash;
+	layout.text = text;
+	layout.vertices.clear();
+
+	const SDL_Color color{ 255, 255, 255, 255 };
+	float pen = 0.0f;
+	for (const char* c = text; *c != '\0'; ++c)
+	{
+		if (*c < c_first_glyph || *c > c_last_glyph)
+		{
+			continue;
+		}
+
+		const Glyph& glyph = m_glyphs[*c - c_first_glyph];
+		const Bounds& uv = glyph.region.uv;
+		const float x0 = pen;
+		const float x1 = pen + glyph.dimensions.x;
+		const float y1 = glyph.dimensions.y;
+
+		layout.vertices.push_back({ { x0, 0.0f }, color, { uv.min.x, uv.min.y } });
+		layout.vertices.push_back({ { x1, 0.0f }, color, { uv.max.x, uv.min.y } });
+		layout.vertices.push_back({ { x1, y1   }, color, { uv.max.x, uv.max.y } });
+		layout.vertices.push_back({ { x0, y1   }, color, { uv.min.x, uv.max.y } });
+		pen += glyph.advance;
+	}
+
+	layout.dimensions = { pen, m_line_height };
+}
+
+bool TextRenderer::construct(SDL_Renderer* renderer, TTF_Font* font)
+{
+	if (renderer == nullptr || font == nullptr)
+	{
+		return false;
+	}
+
+	size_t regions[c_glyph_count]{};
+	for (size_t i = 0; i < c_glyph_count; ++i)
+	{
+		const Uint16 ch = (Uint16)(c_first_glyph + i);
+		SDL_Surface* surface = TTF_RenderGlyph_Blended(font, ch, SDL_Color{ 255, 255, 255, 255 });
+
+		int advance = 0;
+		TTF_GlyphMetrics(font, ch, nullptr, nullptr, nullptr, nullptr, &advance);
+
+		m_glyphs[i].advance = (float)advance;
+		if (surface != nullptr)
+		{
+			m_glyphs[i].dimensions = { (float)surface->w, (float)surface->h };
+		}
+		regions[i] = m_atlas.add(surface);
+	}
+
+	if (!m_atlas.build(renderer))
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < c_glyph_count; ++i)
+	{
+		m_glyphs[i].region = m_atlas.get_region(regions[i]);
+	}
+	m_line_height = (float)TTF_FontHeight(font);
+	return true;
+}
+
+void TextRenderer::draw(SDL_Renderer* renderer, const char* text, const Bounds& target)
+{
+	if (m_atlas.get_texture() == nullptr)
+	{
+		return;
+	}
+
+	const Layout& layout = get_layout(text);
+	if (layout.vertices.empty() || layout.dimensions.x <= 0.0f || layout.dimensions.y <= 0.0f)
+	{
+		return;
+	}
+
+	const Vector2 scale{ (target.max.x - target.min.x) / layout.dimensions.x, (target.max.y - target.min.y) / layout.dimensions.y };
+	m_vertices.resize(layout.vertices.size());
+	for (size_t i = 0; i < layout.vertices.size(); ++i)
+	{
+		SDL_Vertex vertex = layout.vertices[i];
+		vertex.position.x = target.min.x + vertex.position.x * scale.x;
+		vertex.position.y = target.min.y + vertex.position.y * scale.y;
+		m_vertices[i] = vertex;
+	}
+
+	const size_t quads = m_vertices.size() / 4;
+	for (size_t i = m_indices.size() / 6; i < quads; ++i)
+	{
+		const int v = (int)i * 4;
+		m_indices.insert(m_indices.end(), { v, v + 1, v + 2, v + 2, v + 3, v });
+	}
+
+	SDL_RenderGeometry(renderer, m_atlas.get_texture(), m_vertices.data(), (int)m_vertices.size(), m_indices.data(), (int)quads * 6);
+}
+
+TextRenderer::TextRenderer()
+{
+	m_lookup.reserve(c_cache_size);
+}
+
+TextRenderer::~TextRenderer()
+{
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "FMath.h"
+#include "TextureAtlas.h"
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct SDL_Renderer;
+struct SDL_Vertex;
+struct _TTF_Font;
+typedef struct _TTF_Font TTF_Font;
+
+// Draws ASCII text from a glyph atlas built once from a font.
+// Laid out strings are kept in a small LRU cache, so text that doesn't change costs
+// no surface, texture or heap allocation per frame.
+class TextRenderer final
+{
+private:
+	static constexpr char   c_first_glyph = ' ';
+	static constexpr char   c_last_glyph  = '~';
+	static constexpr size_t c_glyph_count = c_last_glyph - c_first_glyph + 1;
+	static constexpr size_t c_cache_size  = 32;
+
+	struct Glyph
+	{
+		TextureRegion region;
+		Vector2       dimensions{};
+		float         advance{ 0.0f };
+	};
+
+	// Quads of a string in font pixels, origin at the top left
+	struct Layout
+	{
+		uint64_t                hash{ 0 };
+		std::string             text;
+		std::vector<SDL_Vertex> vertices;
+		Vector2                 dimensions{};
+	};
+
+	TextureAtlas m_atlas;
+	Glyph        m_glyphs[c_glyph_count]{};
+	float        m_line_height{ 0.0f };
+
+	// Most recently used first
+	std::list<Layout> m_layouts;
+	std::unordered_map<uint64_t, std::list<Layout>::iterator> m_lookup;
+
+	// Scratch buffers for the scaled copy of a layout
+	std::vector<SDL_Vertex> m_vertices;
+	std::vector<int>        m_indices;
+
+	static uint64_t hash(const char* text);
+	const Layout& get_layout(const char* text);
+	void build_layout(Layout& layout, uint64_t hash, const char* text);
+
+public:
+	bool construct(SDL_Renderer* renderer, TTF_Font* font);
+
+	// Stretches the string over target
+	void draw(SDL_Renderer* renderer, const char* text, const Bounds& target);
+
+	TextRenderer();
+	~TextRenderer();
+	TextRenderer(TextRenderer&) = delete;
+};
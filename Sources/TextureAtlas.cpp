@@ -0,0 +1,144 @@
+#include "TextureAtlas.h"
+
+#include <SDL.h>
+#include <algorithm>
+
+void TextureAtlas::pack()
+{
+	// Shelf packing, tallest images first
+	std::vector<size_t> order;
+	int64_t area = 0;
+	int32_t widest = 0;
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		const Entry& entry = m_entries[i];
+		if (entry.surface != nullptr)
+		{
+			order.push_back(i);
+			area  += (int64_t)(entry.w + c_padding) * (entry.h + c_padding);
+			widest = fmath::max(widest, entry.w + c_padding);
+		}
+	}
+
+	std::sort(order.begin(), order.end(), [this](size_t first, size_t second)
+	{
+		return m_entries[first].h > m_entries[second].h;
+	});
+
+	// Roughly square, power of two wide
+	m_width = 1;
+	while (m_width < widest || (int64_t)m_width * m_width < area)
+	{
+		m_width *= 2;
+	}
+
+	int32_t x = 0;
+	int32_t y = 0;
+	int32_t shelf_height = 0;
+	for (size_t i : order)
+	{
+		Entry& entry = m_entries[i];
+		if (x + entry.w > m_width)
+		{
+			x = 0;
+			y += shelf_height + c_padding;
+			shelf_height = 0;
+		}
+
+		entry.x = x;
+		entry.y = y;
+		x += entry.w + c_padding;
+		shelf_height = fmath::max(shelf_height, entry.h);
+	}
+	m_height = fmath::max(y + shelf_height, 1);
+}
+
+size_t TextureAtlas::add(SDL_Surface* surface)
+{
+	Entry entry;
+	entry.surface = surface;
+	if (surface != nullptr)
+	{
+		entry.w = surface->w;
+		entry.h = surface->h;
+	}
+	m_entries.push_back(entry);
+	return m_entries.size() - 1;
+}
+
+bool TextureAtlas::build(SDL_Renderer* renderer)
+{
+	pack();
+
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, m_width, m_height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (atlas == nullptr)
+	{
+		return false;
+	}
+	SDL_FillRect(atlas, nullptr, 0);
+
+	for (Entry& entry : m_entries)
+	{
+		if (entry.surface == nullptr)
+		{
+			continue;
+		}
+
+		// Copy alpha as is instead of blending onto the empty atlas
+		SDL_SetSurfaceBlendMode(entry.surface, SDL_BLENDMODE_NONE);
+		SDL_Rect target{ entry.x, entry.y, entry.w, entry.h };
+		SDL_BlitSurface(entry.surface, nullptr, atlas, &target);
+	}
+
+	m_texture = SDL_CreateTextureFromSurface(renderer, atlas);
+	SDL_FreeSurface(atlas);
+	if (m_texture == nullptr)
+	{
+		return false;
+	}
+	SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+
+	// Only placement is needed from now on, pixels live in the texture
+	for (Entry& entry : m_entries)
+	{
+		SDL_FreeSurface(entry.surface);
+		entry.surface = nullptr;
+	}
+
+	return true;
+}
+
+TextureRegion TextureAtlas::get_region(size_t index) const
+{
+	const Entry& entry = m_entries[index];
+	if (m_texture == nullptr || entry.w == 0 || entry.h == 0)
+	{
+		return {};
+	}
+
+	return {
+		m_texture,
+		{
+			{ entry.x / (float)m_width, entry.y / (float)m_height },
+			{ (entry.x + entry.w) / (float)m_width, (entry.y + entry.h) / (float)m_height }
+		}
+	};
+}
+
+SDL_Texture* TextureAtlas::get_texture() const
+{
+	return m_texture;
+}
+
+TextureAtlas::TextureAtlas()
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	for (Entry& entry : m_entries)
+	{
+		SDL_FreeSurface(entry.surface);
+	}
+	SDL_DestroyTexture(m_texture);
+}
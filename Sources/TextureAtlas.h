@@ -0,0 +1,54 @@
+#pragma once
+#include "FMath.h"
+
+#include <stdint.h>
+#include <vector>
+
+struct SDL_Renderer;
+struct SDL_Texture;
+struct SDL_Surface;
+
+// Part of a texture, uv in [0, 1]
+struct TextureRegion
+{
+	SDL_Texture* texture{ nullptr };
+	Bounds       uv{ { 0.0f, 0.0f }, { 1.0f, 1.0f } };
+};
+
+// Packs images into a single texture at load time, so every sprite can share one texture binding.
+class TextureAtlas final
+{
+private:
+	struct Entry
+	{
+		SDL_Surface* surface{ nullptr };
+		int32_t      x{ 0 };
+		int32_t      y{ 0 };
+		int32_t      w{ 0 };
+		int32_t      h{ 0 };
+	};
+
+	// Transparent gap between images, keeps filtering from bleeding into neighbours
+	static constexpr int32_t c_padding = 1;
+
+	std::vector<Entry> m_entries;
+	SDL_Texture* m_texture{ nullptr };
+	int32_t      m_width{ 0 };
+	int32_t      m_height{ 0 };
+
+	void pack();
+
+public:
+	// Takes ownership of the surface, returns index of the region. Null surfaces get an empty region.
+	size_t add(SDL_Surface* surface);
+
+	// Packs every added image into one texture and frees the surfaces
+	bool build(SDL_Renderer* renderer);
+
+	TextureRegion get_region(size_t index) const;
+	SDL_Texture*  get_texture() const;
+
+	TextureAtlas();
+	~TextureAtlas();
+	TextureAtlas(TextureAtlas&) = delete;
+};
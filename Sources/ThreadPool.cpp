@@ -0,0 +1,147 @@
+#include "ThreadPool.h"
+
+// Which pool the current thread works for, and which queue is its own
+static thread_local const ThreadPool* t_pool{ nullptr };
+static thread_local size_t            t_queue_index{ 0 };
+
+size_t ThreadPool::get_thread_index() const
+{
+	return t_pool == this ? t_queue_index : m_queues.size() - 1;
+}
+
+bool ThreadPool::try_pop(size_t queue_index, QueuedTask& task)
+{
+	// Newest from own queue, it is most likely still in cache
+	{
+		Queue& own = *m_queues[queue_index];
+		std::lock_guard<std::mutex> lock{ own.mutex };
+		if (own.tasks.size() > 0)
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			--m_queued;
+			return true;
+		}
+	}
+
+	// Oldest from the others
+	for (size_t i = 1; i < m_queues.size(); ++i)
+	{
+		Queue& other = *m_queues[(queue_index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock{ other.mutex };
+		if (other.tasks.size() > 0)
+		{
+			task = std::move(other.tasks.front());
+			other.tasks.pop_front();
+			--m_queued;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::run_task(QueuedTask& task)
+{
+	task.fun();
+	task.fun = nullptr;
+	task.counter->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::worker_main(size_t queue_index)
+{
+	t_pool        = this;
+	t_queue_index = queue_index;
+
+	QueuedTask task{ nullptr, nullptr };
+	while (true)
+	{
+		if (try_pop(queue_index, task))
+		{
+			run_task(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ m_sleep_mutex };
+		m_wake.wait(lock, [this]() { return m_stop || m_queued > 0; });
+		if (m_stop)
+		{
+			return;
+		}
+	}
+}
+
+void ThreadPool::submit(PoolTask&& task, TaskCounter& counter)
+{
+	counter.fetch_add(1, std::memory_order_relaxed);
+
+	// Predicate changes under the sleep mutex, so a worker can't miss the wake up.
+	// Counted before the push, so a pop never sees it go below zero.
+	{
+		std::lock_guard<std::mutex> lock{ m_sleep_mutex };
+		++m_queued;
+	}
+
+	Queue& queue = *m_queues[get_thread_index()];
+	{
+		std::lock_guard<std::mutex> lock{ queue.mutex };
+		queue.tasks.push_back({ std::move(task), &counter });
+	}
+	m_wake.notify_one();
+}
+
+void ThreadPool::wait(const TaskCounter& counter)
+{
+	const size_t queue_index = get_thread_index();
+
+	QueuedTask task{ nullptr, nullptr };
+	while (counter.load(std::memory_order_acquire) > 0)
+	{
+		if (try_pop(queue_index, task))
+		{
+			run_task(task);
+		}
+		else
+		{
+			// Remaining tasks are running on other threads
+			std::this_thread::yield();
+		}
+	}
+}
+
+size_t ThreadPool::get_thread_count() const
+{
+	return m_threads.size() + 1;
+}
+
+ThreadPool::ThreadPool(size_t worker_count)
+{
+	for (size_t i = 0; i < worker_count + 1; ++i)
+	{
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+
+	for (size_t i = 0; i < worker_count; ++i)
+	{
+		m_threads.emplace_back(&ThreadPool::worker_main, this, i);
+	}
+}
+
+// Calling thread helps in wait(), so it counts as one of the cores
+ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_sleep_mutex };
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
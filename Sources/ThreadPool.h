@@ -0,0 +1,84 @@
+#pragma once
+#include "InlineFunction.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using PoolTask = InlineFunction<void(), 64>;
+
+// Counts unfinished tasks of a batch, see ThreadPool::submit and ThreadPool::wait
+using TaskCounter = std::atomic<uint32_t>;
+
+// Work-stealing pool, every worker owns a deque and takes from its back,
+// idle workers steal from the front of the others.
+// Threads that wait for a batch run queued tasks instead of blocking.
+class ThreadPool final
+{
+private:
+	struct QueuedTask
+	{
+		PoolTask     fun;
+		TaskCounter* counter;
+	};
+
+	struct Queue
+	{
+		std::mutex             mutex;
+		std::deque<QueuedTask> tasks;
+	};
+
+	// Last queue is shared by threads that aren't workers of this pool
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread>            m_threads;
+
+	std::mutex              m_sleep_mutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t>     m_queued{ 0 };
+	bool                    m_stop{ false };
+
+	bool   try_pop(size_t queue_index, QueuedTask& task);
+	void   run_task(QueuedTask& task);
+	void   worker_main(size_t queue_index);
+
+public:
+	// Counter is incremented now and decremented once the task has finished
+	void submit(PoolTask&& task, TaskCounter& counter);
+
+	// Runs queued tasks until counter drops to zero
+	void wait(const TaskCounter& counter);
+
+	// Calls fun(index) for every index below count, the calling thread takes index 0
+	template<class fn>
+	void parallel_for(size_t count, fn&& fun)
+	{
+		TaskCounter counter{ 0 };
+		for (size_t i = 1; i < count; ++i)
+		{
+			submit([&fun, i]() { fun(i); }, counter);
+		}
+
+		if (count > 0)
+		{
+			fun(0);
+		}
+		wait(counter);
+	}
+
+	// Workers plus the calling thread
+	size_t get_thread_count() const;
+
+	// Below get_thread_count(), threads outside the pool all share the last index
+	size_t get_thread_index() const;
+
+	ThreadPool(size_t worker_count);
+	ThreadPool();
+	~ThreadPool();
+	ThreadPool(ThreadPool&) = delete;
+};
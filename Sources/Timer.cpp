@@ -1,17 +1,72 @@
 #include "Timer.h"
+#include "Config.h"
 
-void Scheduler::schedule(float in_seconds, std::function<void()>&& fun)
+#include <algorithm>
+
+// Min-heap on time, then on scheduling order
+static bool fires_later(const float when1, const uint64_t seq1, const float when2, const uint64_t seq2)
+{
+	return when1 != when2 ? when1 > when2 : seq1 > seq2;
+}
+
+uint32_t Scheduler::acquire_slot()
+{
+	if (m_free_slots.empty())
+	{
+		m_slots.emplace_back();
+		return (uint32_t)(m_slots.size() - 1);
+	}
+
+	const uint32_t slot = m_free_slots.back();
+	m_free_slots.pop_back();
+	return slot;
+}
+
+void Scheduler::release_slot(uint32_t slot)
+{
+	// Bumping generation invalidates handles and heap entries of this slot
+	m_slots[slot].fun = nullptr;
+	++m_slots[slot].generation;
+	m_free_slots.push_back(slot);
+	--m_pending;
+}
+
+TimerHandle Scheduler::schedule(float in_seconds, TimedCallback&& fun)
 {
-	add({ m_accum + in_seconds, fun });
+	return add({ m_accum + in_seconds, std::move(fun) });
 }
 
-void Scheduler::add(TimedPrecedure&& function)
+TimerHandle Scheduler::add(TimedPrecedure&& function)
 {
-	auto upper_bound = std::upper_bound(m_funcs.begin(), m_funcs.end(), function, 
-		[](const TimedPrecedure& first, const TimedPrecedure& second) 
-		{ return first.when < second.when; }
-	);
-	m_funcs.insert(upper_bound, function);
+	const uint32_t slot = acquire_slot();
+	m_slots[slot].fun = std::move(function.fun);
+	++m_pending;
+
+	const uint32_t generation = m_slots[slot].generation;
+	m_heap.push_back({ function.when, m_sequence++, slot, generation });
+	std::push_heap(m_heap.begin(), m_heap.end(), [](const Entry& first, const Entry& second)
+	{
+		return fires_later(first.when, first.sequence, second.when, second.sequence);
+	});
+
+	return { slot, generation };
+}
+
+bool Scheduler::cancel(TimerHandle handle)
+{
+	if (!is_pending(handle))
+	{
+		return false;
+	}
+
+	// Heap entry is dropped lazily when it reaches the top
+	release_slot(handle.slot);
+	return true;
+}
+
+bool Scheduler::is_pending(TimerHandle handle) const
+{
+	return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation && m_slots[handle.slot].fun;
 }
 
 void Scheduler::pause(bool paused)
@@ -21,10 +76,38 @@ void Scheduler::pause(bool paused)
 
 void Scheduler::reset()
 {
-	m_funcs.clear();
+	m_heap.clear();
+	m_free_slots.clear();
+	for (uint32_t slot = 0; slot < m_slots.size(); ++slot)
+	{
+		m_slots[slot].fun = nullptr;
+		++m_slots[slot].generation;
+		m_free_slots.push_back(slot);
+	}
+	m_pending = 0;
+
+	// Nothing is pending, so the clock can restart without losing float precision over long sessions
+	m_accum = 0.0f;
 }
 
-void Scheduler::on_update(float delta_time)
+void Scheduler::reserve(size_t capacity)
+{
+	m_heap.reserve(capacity);
+	m_slots.reserve(capacity);
+	m_free_slots.reserve(capacity);
+}
+
+size_t Scheduler::size() const
+{
+	return m_pending;
+}
+
+void Scheduler::on_fixed_update()
+{
+	advance((float)g_fixed_delta_time);
+}
+
+void Scheduler::advance(float delta_time)
 {
 	if (m_paused)
 	{
@@ -32,23 +115,41 @@ void Scheduler::on_update(float delta_time)
 	}
 
 	m_accum += delta_time;
-	while (m_funcs.size() > 0 && m_accum > m_funcs[0].when)
+	while (m_heap.size() > 0 && m_accum > m_heap.front().when)
 	{
-		m_funcs[0].fun();
-		// List could be erased in lambda
-		if (m_funcs.size() > 0)
+		std::pop_heap(m_heap.begin(), m_heap.end(), [](const Entry& first, const Entry& second)
+		{
+			return fires_later(first.when, first.sequence, second.when, second.sequence);
+		});
+		const Entry entry = m_heap.back();
+		m_heap.pop_back();
+
+		// Cancelled
+		if (m_slots[entry.slot].generation != entry.generation)
 		{
-			m_funcs.erase(m_funcs.begin());
+			continue;
 		}
+
+		// Callback may schedule, cancel or reset, so the slot is released before the call
+		TimedCallback fun{ std::move(m_slots[entry.slot].fun) };
+		release_slot(entry.slot);
+		fun();
 	}
 }
 
+bool Scheduler::is_idle() const
+{
+	return m_paused || m_pending == 0;
+}
+
 Scheduler::Scheduler(bool paused) : m_paused(paused)
 {
+	reserve(c_initial_capacity);
 }
 
 Scheduler::Scheduler()
 {
+	reserve(c_initial_capacity);
 }
 
 Scheduler::~Scheduler()
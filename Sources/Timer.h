@@ -1,31 +1,80 @@
 #pragma once
 #include "Actor.h"
-#include <functional>
-#include <algorithm>
+#include "InlineFunction.h"
+
+#include <stdint.h>
+#include <vector>
+
+using TimedCallback = InlineFunction<void()>;
 
 struct TimedPrecedure
 {
 	float when;
-	std::function<void()> fun;
+	TimedCallback fun;
 };
 
+// Stays valid after its timer fired or was cancelled, it just stops matching
+struct TimerHandle
+{
+	uint32_t slot{ UINT32_MAX };
+	uint32_t generation{ 0 };
+};
+
+// Binary min-heap of timers, callbacks live inline in reusable slots.
+// Insert and fire are O(log n) and don't allocate once capacity is reserved.
 class Scheduler final : public Actor
 {
 private:
+	struct Slot
+	{
+		TimedCallback fun;
+		uint32_t      generation{ 0 };
+	};
+
+	struct Entry
+	{
+		float    when;
+		uint64_t sequence;
+		uint32_t slot;
+		uint32_t generation;
+	};
+
+	static constexpr size_t c_initial_capacity = 64;
+
 	bool m_paused{ true };
 	float m_accum{ 0.0f };
-	std::vector<TimedPrecedure> m_funcs;
+
+	// Timers scheduled for the same time fire in scheduling order
+	uint64_t m_sequence{ 0 };
+
+	std::vector<Entry>    m_heap;
+	std::vector<Slot>     m_slots;
+	std::vector<uint32_t> m_free_slots;
+	size_t                m_pending{ 0 };
+
+	uint32_t acquire_slot();
+	void     release_slot(uint32_t slot);
 
 public:
-	void schedule(float in_seconds, std::function<void()>&& fun);
-	void add(TimedPrecedure&& function);
+	TimerHandle schedule(float in_seconds, TimedCallback&& fun);
+	TimerHandle add(TimedPrecedure&& function);
+	bool cancel(TimerHandle handle);
+	bool is_pending(TimerHandle handle) const;
+
 	void pause(bool paused);
 	void reset();
+	void reserve(size_t capacity);
+	size_t size() const;
+
+	// Fires everything due within delta_time
+	void advance(float delta_time);
 
-	virtual void on_update(float delta_time) override;
+	// Ticks with the simulation, so timers fire on the same fixed frame in every run
+	virtual void on_fixed_update() override;
+	virtual bool is_idle() const override;
 
 	Scheduler(bool paused);
 	Scheduler();
 	virtual ~Scheduler();
 	Scheduler(Scheduler&) = delete;
-};
\ No newline at end of file
+};
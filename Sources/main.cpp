@@ -1,79 +1,411 @@
 #include "Engine.h"
 #include "Arcanoid.h"
+#include "Profiler.h"
 #include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 
-enum EArcanoidLevel
+// Stored with recordings, so a replay runs the game the way it was recorded
+constexpr uint32_t c_recording_autoplay = 1 << 0;
+
+// Moves through the levels, runs every fixed frame after Arcanoid so replays see the same transitions
+class LevelSequence final : public Actor
 {
-	ELEVEL1,
-	ELEVEL2,
-	ELEVEL_NUMBER
+private:
+	std::shared_ptr<Arcanoid>  m_arcanoid;
+	std::shared_ptr<Scheduler> m_ui_delay;
+	std::vector<Level>         m_levels;
+	size_t                     m_next_level{ 1 };
+
+	// Every level is built once, restarts and replays of it restore the snapshot
+	std::vector<GameSnapshot>  m_level_cache;
+
+public:
+	void start_level(size_t level)
+	{
+		GameSnapshot& cached = m_level_cache[level];
+		if (!cached.empty() && m_arcanoid->load_state(cached, false))
+		{
+			return;
+		}
+
+		m_arcanoid->progress_to_next_level();
+		m_arcanoid->spawn_level(m_levels[level]);
+		m_arcanoid->save_state(cached);
+	}
+
+	virtual void on_fixed_update() override
+	{
+		if (m_arcanoid->is_waiting_for_restart)
+		{
+			m_next_level = m_levels.size();
+		}
+
+		if (!m_arcanoid->is_waiting_for_next_level)
+		{
+			return;
+		}
+
+		if (m_next_level < m_levels.size())
+		{
+			start_level(m_next_level++);
+		}
+		else
+		{
+			m_arcanoid->is_restart_allowed = true;
+			if (m_arcanoid->is_restart_requested)
+			{
+				// Restart in 0.5 seconds 
+				m_arcanoid->is_restart_allowed = false;
+				m_arcanoid->is_waiting_for_next_level = false;
+				m_ui_delay->schedule(0.5, [this]() {
+					m_arcanoid->is_waiting_for_next_level = true;
+					start_level(0);
+					m_next_level = 1;
+				});
+			}
+		}
+	}
+
+	LevelSequence(std::shared_ptr<Arcanoid> arcanoid, std::shared_ptr<Scheduler> ui_delay, std::vector<Level> levels)
+		: m_arcanoid(arcanoid), m_ui_delay(ui_delay), m_levels(std::move(levels)), m_level_cache(m_levels.size())
+	{
+	}
 };
 
-void level1(Arcanoid& arcanoid)
+// Files from --level in the order given, otherwise levels/level1.lvl, levels/level2.lvl and on until one is missing
+static std::vector<Level> load_levels(const Arcanoid& arcanoid, int argc, char* argv[])
+{
+	std::vector<Level> levels;
+	bool               listed = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--level") == 0 && i + 1 < argc)
+		{
+			listed = true;
+			Level level;
+			if (level.load(argv[++i]))
+			{
+				levels.push_back(std::move(level));
+			}
+			else
+			{
+				printf("Failed to load %s\n", argv[i]);
+			}
+		}
+	}
+
+	for (uint32_t number = 1; !listed; ++number)
+	{
+		Level level;
+		if (!arcanoid.load_level("levels/level" + std::to_string(number) + ".lvl", level))
+		{
+			break;
+		}
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
+
+struct ProfileSettings
+{
+	bool        overlay{ false };
+	const char* trace_path{ nullptr };
+};
+
+static ProfileSettings parse_profile_settings(int argc, char* argv[])
+{
+	ProfileSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--profile-overlay") == 0)
+		{
+			settings.overlay = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			settings.trace_path = argv[++i];
+		}
+	}
+	return settings;
+}
+
+// Snapshots of the whole game, only readable by the build that wrote them
+struct StateSettings
+{
+	const char* load_path{ nullptr };
+	const char* save_path{ nullptr };
+};
+
+static StateSettings parse_state_settings(int argc, char* argv[])
+{
+	StateSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--load-state") == 0 && i + 1 < argc)
+		{
+			settings.load_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc)
+		{
+			settings.save_path = argv[++i];
+		}
+	}
+	return settings;
+}
+
+// Procedural scenes at growing scale, timed per system
+struct StressSettings
+{
+	bool     enabled{ false };
+	uint32_t frames{ 300 };
+
+	// Unscaled, ten times the default area each way
+	Vector2  area{ g_game_area * 10 };
+};
+
+static constexpr uint32_t c_stress_blocks[]{ 1000, 10000, 100000 };
+static constexpr uint32_t c_stress_balls[]{ 100, 1000, 10000 };
+
+static StressSettings parse_stress_settings(int argc, char* argv[])
+{
+	StressSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--stress") == 0)
+		{
+			settings.enabled = true;
+		}
+		else if (strcmp(argv[i], "--stress-frames") == 0 && i + 1 < argc)
+		{
+			settings.frames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--stress-area") == 0 && i + 2 < argc)
+		{
+			settings.area.x = strtof(argv[++i], nullptr);
+			settings.area.y = strtof(argv[++i], nullptr);
+		}
+	}
+	return settings;
+}
+
+// Every scale point runs the same number of frames from a fresh scene, unpaced.
+// Headless frames don't render, the sprite snapshot is still built so its cost shows up.
+static void run_stress(Engine& engine, Arcanoid& arcanoid, const StressSettings& settings)
 {
-	arcanoid.spawn_block_grid(Vector2{ 10, 10 } *g_scale, 2, 6, Vector2{ 32, 12 } * g_scale, Vector2{ 5, 5 } *g_scale, 1);
-	arcanoid.spawn_block_grid(Vector2{ 40, 100 } *g_scale, 2, 6, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 2);
-	arcanoid.spawn_block_grid(Vector2{ 70, 190 } *g_scale, 2, 6, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 1);
+	if (!g_profile_enabled)
+	{
+		printf("Profiler zones are compiled out, only frame times are reported, configure with -DLARCANOID_PROFILE=ON for systems\n");
+	}
+
+	arcanoid.set_game_area(settings.area);
+	printf("Stress area %.0f x %.0f, %u frames per scale point\n", settings.area.x, settings.area.y, settings.frames);
+
+	const double             perf_freq = (double)SDL_GetPerformanceFrequency();
+	RenderSnapshot           snapshot;
+	std::vector<ProfileStat> stats;
+
+	for (const uint32_t blocks : c_stress_blocks)
+	{
+		for (const uint32_t balls : c_stress_balls)
+		{
+			const uint64_t spawn_begin = SDL_GetPerformanceCounter();
+			arcanoid.spawn_stress_scene(blocks, balls);
+			const double spawn_ms = (SDL_GetPerformanceCounter() - spawn_begin) * 1000.0 / perf_freq;
+
+			// Nothing of the spawn counts towards the frames
+			PROFILE_FRAME();
+			Profiler::get().reset_totals();
+
+			const uint64_t begin  = SDL_GetPerformanceCounter();
+			uint32_t       frames = 0;
+			for (; frames < settings.frames && !engine.is_quit_requested(); ++frames)
+			{
+				engine.process();
+				if (engine.is_headless())
+				{
+					snapshot.clear();
+					arcanoid.on_snapshot(snapshot, 1.0f);
+				}
+			}
+			const double frame_ms = frames > 0 ? (SDL_GetPerformanceCounter() - begin) * 1000.0 / perf_freq / frames : 0.0;
+
+			const entt::registry& registry = arcanoid.get_registry();
+			printf("\nBlocks %u, balls %u: spawned in %.2f ms, %.3f ms per frame, %zu blocks and %zu balls left\n",
+				blocks, balls, spawn_ms, frame_ms, (size_t)registry.size<Block>(), (size_t)registry.size<Ball>());
+
+			PROFILE_FRAME();
+			Profiler::get().get_stats(stats);
+			std::sort(stats.begin(), stats.end(), [](const ProfileStat& first, const ProfileStat& second)
+			{
+				return first.total_ms > second.total_ms;
+			});
+			for (const ProfileStat& stat : stats)
+			{
+				if (stat.total_ms > 0.0 && frames > 0)
+				{
+					printf("  %-32s %9.3f ms\n", stat.name, stat.total_ms / frames);
+				}
+			}
+
+			if (engine.is_quit_requested())
+			{
+				return;
+			}
+		}
+	}
 }
 
-void level2(Arcanoid& arcanoid)
+// Usage: larcanoid [--headless] [--render-thread] [--fps N] [--frames N] [--seconds S] [--seed N]
+//                  [--record FILE | --replay FILE] [--profile-overlay] [--trace FILE]
+//                  [--load-state FILE] [--save-state FILE] [--level FILE]...
+//                  [--stress [--stress-frames N] [--stress-area W H]]
+static EngineSettings parse_settings(int argc, char* argv[])
 {
-	arcanoid.spawn_block_grid(Vector2{ 60, 60 } *g_scale, 2, 8, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 1);
-	arcanoid.spawn_block_grid(Vector2{ 60, 95 } *g_scale, 8, 1, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 3);
-	arcanoid.spawn_block_grid(Vector2{ 281, 95 } *g_scale, 8, 1, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 3);
-	arcanoid.spawn_block_grid(Vector2{ 60, 230 } *g_scale, 1, 7, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 1);
-	arcanoid.spawn_block_grid(Vector2{ 120, 190 } *g_scale, 1, 4, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 2);
-	arcanoid.spawn_block_grid(Vector2{ 120, 120 } *g_scale, 1, 4, Vector2{ 32, 12 } *g_scale, Vector2{ 5, 5 } *g_scale, 2);
+	EngineSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			settings.headless = true;
+		}
+		else if (strcmp(argv[i], "--render-thread") == 0)
+		{
+			settings.render_thread = true;
+		}
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+		{
+			settings.target_frame_rate = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			settings.max_frames = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+		{
+			settings.max_simulated_time = strtod(argv[++i], nullptr);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			settings.seed = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			settings.record_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			settings.replay_path = argv[++i];
+		}
+	}
+	return settings;
 }
 
 int main(int argc, char* argv[])
 {
-	Engine engine;
+	EngineSettings       settings = parse_settings(argc, argv);
+	const StressSettings stress   = parse_stress_settings(argc, argv);
+
+	// Stress frames are timed, pacing would only add sleep to them
+	if (stress.enabled)
+	{
+		settings.target_frame_rate = 0;
+	}
+
+	Engine engine{ settings };
+
+	auto thread_pool = std::make_shared<ThreadPool>();
 
 	auto scheduler = engine.create_actor<Scheduler>();
-	auto arcanoid  = engine.create_actor<Arcanoid>(scheduler);
+	auto arcanoid  = engine.create_actor<Arcanoid>(scheduler, thread_pool, engine.get_seed());
 	auto ui_delay  = engine.create_actor<Scheduler>(false);
 
-	level1(*arcanoid);
-	EArcanoidLevel next_level = ELEVEL2;
+	// Nobody is there to press the keys, unless a replay does
+	arcanoid->is_autoplay = engine.is_replaying() ? (engine.get_recording_flags() & c_recording_autoplay) != 0 : engine.is_headless();
+	engine.set_recording_flags(arcanoid->is_autoplay ? c_recording_autoplay : 0);
+
+	const ProfileSettings profile = parse_profile_settings(argc, argv);
+	if ((profile.overlay || profile.trace_path) && !g_profile_enabled)
+	{
+		printf("Profiler zones are compiled out, configure with -DLARCANOID_PROFILE=ON\n");
+	}
+	arcanoid->is_profile_overlay = profile.overlay;
+	Profiler::get().set_capture(profile.trace_path != nullptr);
+
+	if (stress.enabled)
+	{
+		arcanoid->is_autoplay = true;
+		run_stress(engine, *arcanoid, stress);
+
+		if (profile.trace_path && !Profiler::get().write_chrome_trace(profile.trace_path))
+		{
+			printf("Failed to write %s\n", profile.trace_path);
+		}
+		return 0;
+	}
+
+	std::vector<Level> level_files = load_levels(*arcanoid, argc, argv);
+	if (level_files.empty())
+	{
+		printf("No levels to play\n");
+		return 1;
+	}
+	auto levels = engine.create_actor<LevelSequence>(arcanoid, ui_delay, std::move(level_files));
+
+	StateSettings       state = parse_state_settings(argc, argv);
+	GameSnapshot        snapshot;
+	if (state.load_path && (!snapshot.load(state.load_path) || !arcanoid->load_state(snapshot, true)))
+	{
+		printf("Failed to load %s, starting from the first level\n", state.load_path);
+		state.load_path = nullptr;
+	}
+	if (!state.load_path)
+	{
+		levels->start_level(0);
+	}
 
 	while (!engine.is_quit_requested())
 	{
 		engine.process();
+	}
+
+	if (engine.is_headless())
+	{
+		const SimulationStats stats = engine.get_simulation_stats();
+		printf("Simulated %llu frames (%.2f s) in %.3f s, %.1f frames per second\n",
+			(unsigned long long)stats.frames, stats.simulated_time, stats.wall_time, stats.frames_per_second);
 
-		if (arcanoid->is_waiting_for_restart)
+		// Same seed and inputs end in the same state, compare these between replays
+		const PlayerState& player_state = arcanoid->get_player_state();
+		printf("Seed %llu, level %i, score %i, lives %i\n",
+			(unsigned long long)engine.get_seed(), player_state.level, player_state.score, player_state.lives);
+	}
+	else
+	{
+		const SimulationStats stats = engine.get_simulation_stats();
+		if (stats.dropped_frames > 0)
 		{
-			next_level = ELEVEL_NUMBER;
+			printf("Dropped %llu fixed steps (%.2f s) while behind\n", (unsigned long long)stats.dropped_frames, stats.dropped_time);
 		}
+	}
 
-		if (arcanoid->is_waiting_for_next_level)
+	if (state.save_path)
+	{
+		arcanoid->save_state(snapshot);
+		if (!snapshot.save(state.save_path))
 		{
-
-			switch (next_level)
-			{
-			case ELEVEL2:
-				arcanoid->progress_to_next_level();
-				level2(*arcanoid);
-				next_level = ELEVEL_NUMBER;
-				break;
-			default:
-				arcanoid->is_restart_allowed = true;
-				if (arcanoid->is_restart_requested)
-				{
-					// Restart in 0.5 seconds 
-					arcanoid->is_restart_allowed = false;
-					arcanoid->is_waiting_for_next_level = false;
-					ui_delay->schedule(0.5, [&]() {
-						arcanoid->is_waiting_for_next_level = true;
-						arcanoid->progress_to_next_level();
-						level1(*arcanoid);
-						next_level = ELEVEL2;
-					});
-				}
-				break;
-			}
+			printf("Failed to write %s\n", state.save_path);
 		}
 	}
 
+	if (profile.trace_path && !Profiler::get().write_chrome_trace(profile.trace_path))
+	{
+		printf("Failed to write %s\n", profile.trace_path);
+	}
+
 	return 0;
 }
\ No newline at end of file